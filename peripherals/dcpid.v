@@ -0,0 +1,565 @@
+// *********************************************************
+// Copyright (c) 2022 Demand Peripherals, Inc.
+// 
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+// 
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+// 
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+// 
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+//////////////////////////////////////////////////////////////////////////
+//
+//  File: dcpid.v;   A closed-loop DC motor controller
+//
+//  The FPGA peripheral combines one H-bridge output (as in dc2) with one
+//  quadrature decoder (as in quad2) and closes a PID speed or position
+//  loop in the FPGA.  The loop runs at a fixed rate set by the host and
+//  does not depend on the round trip time to the host.  The first two
+//  pins are the AIN1 and AIN2 inputs to a TB6612 style H-bridge.  The
+//  third and fourth pins are the A and B inputs from the motor encoder.
+//
+//  The modes of operation are as follows:
+//      (0) Brake       Both outputs high.  The power-on default.
+//      (1) Open loop   Effort is the low 16 bits of the setpoint
+//      (2) Velocity    Setpoint is counts per loop period (low 16 bits)
+//      (3) Position    Setpoint is a 32 bit signed encoder count
+//
+//  The PWM uses the same 10-bit "period" counter and clock select as dc2.
+//  The effort is a signed value in units of the PWM counter.  Positive
+//  effort drives AIN1 and negative effort drives AIN2.  During the PWM
+//  off time the outputs either coast (both low) or brake (both high).
+//
+//  The loop rate is set in register 11 in units of 100 microseconds with
+//  zero giving a 10 KHz loop.  At each loop tick the velocity is taken as
+//  the change in position since the last tick.  In position mode the
+//  internal target moves toward the setpoint by at most the velocity limit
+//  on each tick.  A velocity limit of zero moves the target directly to the
+//  setpoint.  In the other modes the target follows the position so the
+//  first move after entering position mode starts from where the motor is.
+//  A change of mode clears the integrator.  The error is saturated to 16
+//  bits and the PID is computed using a single shared multiplier over a
+//  few system clocks:
+//      P = Kp * err
+//      I = I + (Ki * err), clamped to +/- (integral limit * 256)
+//      D = Kd * (err - preverr)
+//      effort = (P + I + D) / 256, clamped to +/- effort limit
+//  So the gains are unsigned 8.8 fixed point values.  The TB6612 has no
+//  current sense output, so the effort limit is the current limit.
+//
+//  Telemetry of position, velocity, and effort is latched at the end of
+//  a loop computation.  If the decimation register is non-zero the
+//  telemetry is sent to the host every "decimation" loop ticks.  Reading
+//  register 0 copies the rest of the telemetry into a snapshot that
+//  registers 1-7 read from so a host read always sees a consistent set of
+//  values, even if the host stops before register 7.
+//
+//  Register 13 is the watchdog.  If enabled (bit 7 == 1) the low four bits
+//  are decremented every 100 milliseconds.  If the count reaches zero the
+//  motor is braked and the integrator is cleared.  The host must rewrite
+//  register 13 to keep the motor running.
+//
+//  Registers
+//  0-3:   Position, signed 32 bits (high byte first)
+//  4,5:   Velocity in counts per loop period, signed 16 bits
+//  6,7:   Effort, signed 16 bits
+//  8  :   Clock select in [7:5], brake in off time in [2], period[9:8] in [1:0]
+//  9  :   Period[7:0]
+//  10 :   Mode in [1:0].  Writing a one to bit 5 clears the position
+//  11 :   Loop period in units of 100 us, zero indexed
+//  12 :   Telemetry decimation in loop periods.  0 = off
+//  13 :   Watchdog enable in [7], watchdog count in [3:0]
+//  14 :   Unused
+//  15 :   Unused
+//  16-19: Setpoint, signed 32 bits.  Latched on the write of register 19
+//  20,21: Kp, unsigned 8.8
+//  22,23: Ki, unsigned 8.8
+//  24,25: Kd, unsigned 8.8
+//  26,27: Integral limit in units of effort
+//  28,29: Effort limit in PWM counts (10 bits)
+//  30,31: Velocity limit in counts per loop period for position mode
+//
+//  The clock source is selected by the upper 3 bits of register 8:
+//      0:  Off
+//      1:  20 MHz
+//      2:  10 MHz
+//      3:  5 MHz
+//      4:  1 MHz
+//      5:  500 KHz
+//      6:  100 KHz
+//      7:  50 KHz
+//
+/////////////////////////////////////////////////////////////////////////
+
+`define PIDBRAKE   2'h0
+`define PIDOPEN    2'h1
+`define PIDVEL     2'h2
+`define PIDPOS     2'h3
+
+
+module dcpid(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins);
+    input  CLK_I;            // system clock
+    input  WE_I;             // direction of this transfer. Read=0; Write=1
+    input  TGA_I;            // ==1 if reg access, ==0 if poll
+    input  STB_I;            // ==1 if this peri is being addressed
+    input  [7:0] ADR_I;      // address of target register
+    output STALL_O;          // ==1 if we need more clk cycles to complete
+    output ACK_O;            // ==1 if we claim the above address
+    input  [7:0] DAT_I;      // Data INto the peripheral;
+    output [7:0] DAT_O;      // Data OUTput from the peripheral, = DAT_I if not us.
+    input  [`MXCLK:0] clocks; // Array of clock pulses from 10ns to 1 second
+    inout  [3:0] pins;       // FPGA I/O pins
+
+    wire m100clk =  clocks[`M100CLK];    // utility 100.0 millisecond pulse on global clock line
+    wire u100clk =  clocks[`U100CLK];    // utility 100.0 microsecond pulse on global clock line
+    wire u10clk  =  clocks[`U10CLK];     // utility 10.00 microsecond pulse on global clock line
+    wire u1clk   =  clocks[`U1CLK];      // utility 1.000 microsecond pulse on global clock line
+    wire n100clk =  clocks[`N100CLK];    // utility 100.0 nanosecond pulse on global clock line
+
+    assign pins[0] = ain1;   // TB6612 AIN1 input
+    assign pins[1] = ain2;   // TB6612 AIN2 input
+    wire   enca = pins[2];   // encoder input A
+    wire   encb = pins[3];   // encoder input B
+
+    wire   myaddr;           // ==1 if a correct read/write on our address
+
+    // PWM registers and lines
+    reg    [2:0] freq;       // Selects source of input clock
+    reg    [9:0] period;     // PWM period in units of the clock selected above
+    reg    offbrake;         // ==1 to brake in PWM off time, ==0 to coast
+    reg    [9:0] count;      // Count upon which all comparisons are done
+    wire   pclk;             // period input clock
+    wire   lclk;             // Prescale clock
+    reg    lreg;             // Prescale clock divided by two
+    wire   pwmon;            // ==1 if in the on part of the PWM cycle
+    wire   [15:0] eabs;      // absolute value of the effort
+
+    // Loop configuration
+    reg    [1:0] mode;       // brake, open loop, velocity, position
+    reg    [7:0] looprate;   // loop period in units of 100 us, zero indexed
+    reg    [7:0] loopdiv;    // loop period counter
+    reg    [7:0] decim;      // send telemetry every decim loop periods
+    reg    [7:0] deccnt;     // telemetry decimation counter
+    reg    [3:0] dogcnt;     // watchdog timeout in units of 100 ms
+    reg    dogon;            // ==1 if watchdog is enabled
+    wire   dogstop;          // ==1 if watchdog expired
+    reg    signed [31:0] setpoint; // position, velocity, or effort setpoint
+    reg    [23:0] spshadow;  // high bytes of setpoint until low byte is written
+    reg    [15:0] kp;        // proportional gain
+    reg    [15:0] ki;        // integral gain
+    reg    [15:0] kd;        // derivative gain
+    reg    [15:0] ilimit;    // integral clamp in units of effort
+    reg    [9:0] elimit;     // effort clamp in PWM counts
+    reg    [15:0] vlimit;    // maximum change in target per loop period
+
+    // Quadrature decoder
+    reg    a_1,a_2;          // encoder A in our clock domain and its last value
+    reg    b_1,b_2;          // encoder B in our clock domain and its last value
+    wire   incr;             // ==1 to increment the position
+    wire   decr;             // ==1 to decrement the position
+    reg    signed [31:0] pos;      // encoder position
+    reg    signed [31:0] lastpos;  // position at the last loop tick
+    reg    signed [31:0] target;   // rate limited position setpoint
+    reg    signed [15:0] vel;      // velocity in counts per loop period
+
+    // PID state and arithmetic
+    reg    [2:0] pidst;      // idle or which step of the PID computation
+    reg    signed [15:0] err;      // saturated error
+    reg    signed [15:0] preverr;  // error from the last loop tick
+    reg    signed [15:0] derr;     // saturated change in error
+    reg    signed [35:0] pterm;    // Kp * err
+    reg    signed [35:0] integ;    // sum of Ki * err, clamped
+    reg    signed [35:0] dterm;    // Kd * derr
+    reg    signed [15:0] effort;   // signed PWM on count
+    wire   signed [16:0] mulerr;   // multiplier input from error
+    wire   signed [16:0] mulgain;  // multiplier input from gains
+    wire   signed [33:0] product;  // the one multiplier
+    wire   signed [35:0] prodx;    // product sign extended
+    wire   signed [35:0] isum;     // new integrator value before clamp
+    wire   signed [35:0] ilim;     // integrator clamp
+    wire   signed [37:0] pidsum;   // P + I + D
+    wire   signed [29:0] rawout;   // effort before clamp
+    wire   signed [29:0] elim;     // effort clamp
+    wire   signed [15:0] neweff;   // effort after clamp
+    wire   signed [32:0] pdelta;   // change in position since last tick
+    wire   signed [32:0] tdiff;    // setpoint - target
+    wire   signed [32:0] perr;     // position error
+    wire   signed [32:0] verr;     // velocity error
+    wire   signed [32:0] dediff;   // change in error
+
+    // Telemetry
+    reg    signed [31:0] tpos;     // latched position
+    reg    signed [15:0] tvel;     // latched velocity
+    reg    signed [15:0] teff;     // latched effort
+    reg    data_avail;       // ==1 if telemetry is ready to send to host
+    reg    [55:0] snap;      // telemetry bytes 1-7 as of the read of reg 0
+
+
+    // Generate the clock source for the PWM counter
+    assign lclk = (freq[2:1] == 0) ? CLK_I :
+                  (freq[2:1] == 1) ? n100clk :
+                  (freq[2:1] == 2) ? u1clk : u10clk;
+    assign pclk = (freq[0] == 1) ? (lreg & lclk) : lclk ;
+
+
+    initial
+    begin
+        freq = 0;            // clock is off to start
+        period = 0;
+        offbrake = 1;
+        count = 0;
+        lreg = 0;
+        mode = `PIDBRAKE;    // default is to brake
+        looprate = 9;        // 1 KHz loop
+        loopdiv = 0;
+        decim = 0;           // no telemetry
+        deccnt = 0;
+        dogon = 0;
+        dogcnt = 0;
+        setpoint = 0;
+        kp = 0;
+        ki = 0;
+        kd = 0;
+        ilimit = 0;
+        elimit = 0;
+        vlimit = 0;
+        pos = 0;
+        lastpos = 0;
+        target = 0;
+        vel = 0;
+        pidst = 0;
+        err = 0;
+        preverr = 0;
+        integ = 0;
+        effort = 0;
+        data_avail = 0;
+        snap = 0;
+    end
+
+
+    always @(posedge CLK_I)
+    begin
+        // Handle write requests from the host
+        if (TGA_I & myaddr & WE_I)  // latch data on a write
+        begin
+            if (ADR_I[4:0] == 8)        // clock select and period
+            begin
+                freq <= DAT_I[7:5];
+                offbrake <= DAT_I[2];
+                period[9:8] <= DAT_I[1:0];
+            end
+            if (ADR_I[4:0] == 9)
+                period[7:0] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 10)       // mode
+                mode <= DAT_I[1:0];
+            if (ADR_I[4:0] == 11)       // loop period
+                looprate <= DAT_I[7:0];
+            if (ADR_I[4:0] == 12)       // telemetry decimation
+                decim <= DAT_I[7:0];
+            if (ADR_I[4:0] == 13)       // watchdog
+            begin
+                dogon <= DAT_I[7];
+                dogcnt <= DAT_I[3:0];
+            end
+            if (ADR_I[4:0] == 16)       // setpoint, latched on low byte
+                spshadow[23:16] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 17)
+                spshadow[15:8] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 18)
+                spshadow[7:0] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 19)
+                setpoint <= {spshadow, DAT_I[7:0]};
+            if (ADR_I[4:0] == 20)       // gains
+                kp[15:8] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 21)
+                kp[7:0] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 22)
+                ki[15:8] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 23)
+                ki[7:0] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 24)
+                kd[15:8] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 25)
+                kd[7:0] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 26)       // limits
+                ilimit[15:8] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 27)
+                ilimit[7:0] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 28)
+                elimit[9:8] <= DAT_I[1:0];
+            if (ADR_I[4:0] == 29)
+                elimit[7:0] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 30)
+                vlimit[15:8] <= DAT_I[7:0];
+            if (ADR_I[4:0] == 31)
+                vlimit[7:0] <= DAT_I[7:0];
+        end
+
+        // Snapshot the telemetry on the read of register 0.  The read of
+        // register 7 ends an autosend.
+        if (TGA_I & myaddr & ~WE_I)
+        begin
+            if (ADR_I[4:0] == 0)
+                snap <= {tpos[23:0], tvel, teff};
+            else if (ADR_I[4:0] == 7)
+                data_avail <= 0;
+        end
+
+        // Get the half rate clock
+        if (lclk)
+            lreg <= ~lreg;
+
+        // Do the PWM period counter
+        if ((freq != 0) && (pclk || (freq == 1)))
+        begin
+            if (count >= period)
+                count <= 1;
+            else
+                count <= count + 10'h001;
+        end
+
+        // Handle the watchdog timer
+        if (dogon && m100clk && (dogcnt != 0))
+            dogcnt <= dogcnt - 4'h1;
+
+        // Bring the encoder inputs into our clock domain and count edges.
+        // Clearing the position also clears the loop history.
+        a_1 <= enca;
+        a_2 <= a_1;
+        b_1 <= encb;
+        b_2 <= b_1;
+        if (TGA_I & myaddr & WE_I & (ADR_I[4:0] == 10) & DAT_I[5])
+        begin
+            pos <= 0;
+            lastpos <= 0;
+            target <= 0;
+            integ <= 0;
+            preverr <= 0;
+        end
+        else
+        begin
+            if (incr)
+                pos <= pos + 32'h00000001;
+            else if (decr)
+                pos <= pos - 32'h00000001;
+
+            // Start the loop computation at each loop tick
+            if (u100clk && (pidst == 0))
+            begin
+                if (loopdiv == looprate)
+                begin
+                    loopdiv <= 0;
+                    pidst <= 1;
+                end
+                else
+                    loopdiv <= loopdiv + 8'h01;
+            end
+
+            // Step 1: get velocity and move the target toward the setpoint
+            else if (pidst == 1)
+            begin
+                vel <= sat16(pdelta);
+                lastpos <= pos;
+                if (mode != `PIDPOS)
+                    target <= pos;
+                else if (vlimit == 0)
+                    target <= setpoint;
+                else if (tdiff > $signed({17'h00000, vlimit}))
+                    target <= target + $signed({16'h0000, vlimit});
+                else if (tdiff < -$signed({17'h00000, vlimit}))
+                    target <= target - $signed({16'h0000, vlimit});
+                else
+                    target <= setpoint;
+                pidst <= 2;
+            end
+
+            // Step 2: get the error and the change in error
+            else if (pidst == 2)
+            begin
+                err <= (mode == `PIDPOS) ? sat16(perr) : sat16(verr);
+                pidst <= 3;
+            end
+
+            // Step 3: proportional term
+            else if (pidst == 3)
+            begin
+                derr <= sat16(dediff);
+                preverr <= err;
+                pterm <= prodx;
+                pidst <= 4;
+            end
+
+            // Step 4: integral term with clamp.  Only integrate in a loop mode.
+            else if (pidst == 4)
+            begin
+                if ((mode == `PIDBRAKE) || (mode == `PIDOPEN) || dogstop)
+                    integ <= 0;
+                else if (isum > ilim)
+                    integ <= ilim;
+                else if (isum < -ilim)
+                    integ <= -ilim;
+                else
+                    integ <= isum;
+                pidst <= 5;
+            end
+
+            // Step 5: derivative term
+            else if (pidst == 5)
+            begin
+                dterm <= prodx;
+                pidst <= 6;
+            end
+
+            // Step 6: clamp and apply the effort, latch telemetry
+            else if (pidst == 6)
+            begin
+                effort <= neweff;
+                if (~data_avail)
+                begin
+                    tpos <= pos;
+                    tvel <= vel;
+                    teff <= neweff;
+                end
+                if ((deccnt + 8'h01) >= decim)
+                begin
+                    deccnt <= 0;
+                    if (decim != 0)
+                        data_avail <= 1;
+                end
+                else
+                    deccnt <= deccnt + 8'h01;
+                pidst <= 0;
+            end
+        end
+
+        // A mode change restarts the loop history so a velocity integrator
+        // does not carry into position mode.  The target starts at the
+        // current position so the first move is velocity limited.
+        if (TGA_I & myaddr & WE_I & (ADR_I[4:0] == 10) & ~DAT_I[5] &
+            (DAT_I[1:0] != mode))
+        begin
+            target <= pos;
+            integ <= 0;
+            preverr <= 0;
+        end
+    end
+
+
+    // Saturate a 33 bit signed value to 16 bits
+    function [15:0] sat16;
+        input [32:0] v;
+        begin
+            sat16 = (v[32] && ~(&v[31:15])) ? 16'h8000 :
+                    (~v[32] && (|v[31:15])) ? 16'h7fff :
+                    v[15:0];
+        end
+    endfunction
+
+
+    // Error terms.  All are one bit wider than their inputs.
+    assign pdelta = {pos[31], pos} - {lastpos[31], lastpos};
+    assign tdiff  = {setpoint[31], setpoint} - {target[31], target};
+    assign perr   = {target[31], target} - {pos[31], pos};
+    assign verr   = {{17{setpoint[15]}}, setpoint[15:0]} - {{17{vel[15]}}, vel};
+    assign dediff = {{17{err[15]}}, err} - {{17{preverr[15]}}, preverr};
+
+    // The shared multiplier.  Gains are unsigned.
+    assign mulgain = (pidst == 4) ? {1'b0, ki} :
+                     (pidst == 5) ? {1'b0, kd} : {1'b0, kp};
+    assign mulerr  = (pidst == 5) ? {derr[15], derr} : {err[15], err};
+    assign product = mulerr * mulgain;
+    assign prodx   = {{2{product[33]}}, product};
+
+    // Integrator and output clamps
+    assign isum   = integ + prodx;
+    assign ilim   = {12'h000, ilimit, 8'h00};
+    assign pidsum = {{2{pterm[35]}}, pterm} + {{2{integ[35]}}, integ} +
+                    {{2{dterm[35]}}, dterm};
+    assign rawout = (mode == `PIDOPEN) ? {{14{setpoint[15]}}, setpoint[15:0]} :
+                    pidsum[37:8];
+    assign elim   = {20'h00000, elimit};
+    assign neweff = ((mode == `PIDBRAKE) || dogstop) ? 16'h0000 :
+                    (rawout > elim) ? elim[15:0] :
+                    (rawout < -elim) ? -elim[15:0] :
+                    rawout[15:0];
+
+
+    // Detect the encoder edges to count
+    assign incr = ((a_2 != a_1) && (a_2 ^ b_2)) ||
+                  ((b_2 != b_1) && (~(a_2 ^ b_2)));
+    assign decr = ((a_2 != a_1) && (~(a_2 ^ b_2))) ||
+                  ((b_2 != b_1) && (a_2 ^ b_2));
+
+
+    // Assign the outputs.  Positive effort drives AIN1 and negative
+    // effort drives AIN2.  Brake mode or an expired watchdog drive both.
+    assign dogstop = (dogon && (dogcnt == 0));  // ==1 if watchdog expired
+    assign eabs  = (effort[15]) ? (16'h0000 - effort) : effort;
+    assign pwmon = (freq != 0) && (count != 0) && (eabs != 0) && (count <= eabs[9:0]);
+    assign ain1  = dogstop | (mode == `PIDBRAKE) |
+                   (pwmon & ~effort[15]) | (~pwmon & offbrake);
+    assign ain2  = dogstop | (mode == `PIDBRAKE) |
+                   (pwmon & effort[15]) | (~pwmon & offbrake);
+
+
+    assign myaddr = (STB_I) && (ADR_I[7:5] == 0);
+    assign DAT_O = (~myaddr) ? DAT_I :
+                    // send 8 bytes of telemetry.  decim==0 turns off auto-updates
+                    (~TGA_I && data_avail && (decim != 0)) ? 8'h08 :
+                    (~TGA_I) ? 8'h00 :
+                    (ADR_I[4:0] == 0) ? tpos[31:24] :
+                    (ADR_I[4:0] == 1) ? snap[55:48] :
+                    (ADR_I[4:0] == 2) ? snap[47:40] :
+                    (ADR_I[4:0] == 3) ? snap[39:32] :
+                    (ADR_I[4:0] == 4) ? snap[31:24] :
+                    (ADR_I[4:0] == 5) ? snap[23:16] :
+                    (ADR_I[4:0] == 6) ? snap[15:8] :
+                    (ADR_I[4:0] == 7) ? snap[7:0] :
+                    (ADR_I[4:0] == 8) ? {freq, 2'h0, offbrake, period[9:8]} :
+                    (ADR_I[4:0] == 9) ? period[7:0] :
+                    (ADR_I[4:0] == 10) ? {6'h00, mode} :
+                    (ADR_I[4:0] == 11) ? looprate :
+                    (ADR_I[4:0] == 12) ? decim :
+                    (ADR_I[4:0] == 13) ? {dogon, 3'h0, dogcnt} :
+                    (ADR_I[4:0] == 16) ? setpoint[31:24] :
+                    (ADR_I[4:0] == 17) ? setpoint[23:16] :
+                    (ADR_I[4:0] == 18) ? setpoint[15:8] :
+                    (ADR_I[4:0] == 19) ? setpoint[7:0] :
+                    (ADR_I[4:0] == 20) ? kp[15:8] :
+                    (ADR_I[4:0] == 21) ? kp[7:0] :
+                    (ADR_I[4:0] == 22) ? ki[15:8] :
+                    (ADR_I[4:0] == 23) ? ki[7:0] :
+                    (ADR_I[4:0] == 24) ? kd[15:8] :
+                    (ADR_I[4:0] == 25) ? kd[7:0] :
+                    (ADR_I[4:0] == 26) ? ilimit[15:8] :
+                    (ADR_I[4:0] == 27) ? ilimit[7:0] :
+                    (ADR_I[4:0] == 28) ? {6'h00, elimit[9:8]} :
+                    (ADR_I[4:0] == 29) ? elimit[7:0] :
+                    (ADR_I[4:0] == 30) ? vlimit[15:8] :
+                    (ADR_I[4:0] == 31) ? vlimit[7:0] :
+                    8'h00;
+
+    // Loop in-to-out where appropriate
+    assign STALL_O = 0;
+    assign ACK_O = myaddr;
+
+endmodule
@@ -42,14 +42,37 @@
 //    Addr=14   Channel 7 ADC value (high/low)
 //    Addr=16   Sample interval in ms
 //    Addr=17   differ bits (set for differential input)
+//    Addr=18   Streaming channel mask.  Zero for the interval mode above
+//    Addr=19   Log2 of the number of samples to average (0-7)
+//    Addr=20   Averaging channel mask
 //  NOTES: 
 //
+//  STREAMING MODE
+//      A non-zero channel mask in register 18 switches the peripheral from
+//  the sample interval mode to a streaming mode.  The channels in the mask
+//  are sampled back-to-back at the full ESPI rate.  Each sample takes 21
+//  bit times of 600 ns, or about 79000 samples per second shared among the
+//  selected channels.
+//      Channels set in the averaging mask are passed through a boxcar
+//  decimator that sums 2^N samples and outputs the sum divided by 2^N,
+//  where N is register 19.  Other selected channels output every sample.
+//      Each sample is stored as two bytes with the channel number in the
+//  high three bits and the 13 bit signed ADC value in the low bits.
+//  Samples are packed into 255 byte blocks that start with an eight bit
+//  sequence number followed by 127 samples.  Blocks are held in a two
+//  block RAM FIFO and autosent to the host as one 255 byte packet.  If
+//  both blocks are full the newest block is dropped but the sequence
+//  number is still incremented so the host can detect the lost block.
+//      In streaming mode host reads of registers 0 to 254 return the bytes
+//  of the oldest full block and a read of register 254 frees the block.
+//  The per channel registers 0 to 15 are not updated while streaming.
 //
 /////////////////////////////////////////////////////////////////////////
 
 `define ADCIDLE         2'h0
 `define ADCGETSMPL      2'h1
 `define ADCSNDRPLY      2'h2
+`define ADCSTREAM       2'h3
 
 
 module dpadc12(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins);
@@ -87,6 +110,31 @@ module dpadc12(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pin
     reg    [2:0] smplinx;    // Which sample we're reading
     reg    [4:0] bitinx;     // Which bit of smplinx we reading/writing
     reg    [2:0] espiinx;    // Which substate of an espi bit we're in
+    wire   active;           // ==1 if doing an ESPI transfer
+
+    // Streaming state and FIFO lines
+    reg    [7:0] smask;      // Channels to sample in streaming mode
+    reg    [2:0] declog;     // Log2 of the number of samples to average
+    reg    [7:0] avgmask;    // Channels to average in streaming mode
+    reg    [12:0] smpl;      // Sample shifted in from the ADC
+    reg    [6:0] round;      // Which round of samples in the average
+    wire   [6:0] rndmax;     // Last round in the average
+    wire   smplend;          // ==1 at the end of a streaming sample
+    wire   [19:0] accout;    // Accumulator RAM output
+    wire   [19:0] accsum;    // Accumulator plus the new sample
+    wire   [19:0] accshft;   // Accumulator divided by number of samples
+    reg    [15:0] outval;    // Channel and sample to write to the FIFO
+    reg    [1:0] wst;        // FIFO write state: idle, seq number, high, low
+    reg    [7:0] woff;       // Offset of the next write into the block
+    reg    wblk;             // Block being filled.  ~wblk is sent to host
+    reg    pend;             // ==1 if block ~wblk is full and waiting for host
+    reg    [7:0] seq;        // Block sequence number
+    reg    stalled;          // ==1 on second clock of a FIFO read
+    wire   rdone;            // ==1 when the host reads the last byte of a block
+    wire   fwe;              // FIFO write enable
+    wire   [8:0] fwa;        // FIFO write address
+    wire   [7:0] fwd;        // FIFO write data
+    wire   [7:0] frd;        // FIFO read data
 
     initial
     begin
@@ -94,12 +142,28 @@ module dpadc12(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pin
         ratediv = 0;
         differ = 0;
         state = `ADCIDLE;
+        smask = 0;
+        declog = 0;
+        avgmask = 0;
+        round = 0;
+        wst = 0;
+        woff = 0;
+        wblk = 0;
+        pend = 0;
+        seq = 0;
+        stalled = 0;
     end
 
 
     // Register array in RAM
     dpadcram16x8 dpadcram(dout,raddr,din,wclk,wen);
 
+    // Boxcar accumulators, one per channel
+    dpadcacc8x20 dpadcacc(accout,smplinx,accsum,CLK_I,smplend);
+
+    // Two block sample FIFO with synchronous read
+    dpadcfifo dpadcfifo(CLK_I,fwe,fwa,fwd,{~wblk,ADR_I},frd);
+
     always @(posedge CLK_I)
     begin
         // Bring MISO into our clock domain
@@ -116,6 +180,37 @@ module dpadc12(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pin
             begin
                 differ <= DAT_I[7:0];
             end
+            else if (ADR_I[4:0] == 18)
+            begin
+                // Any write to the stream mask restarts the stream
+                smask <= DAT_I[7:0];
+                state <= (DAT_I != 0) ? `ADCSTREAM : `ADCIDLE;
+                smplinx <= 0;
+                bitinx  <= 0;
+                espiinx <= 0;
+                round <= 0;
+                wst <= 0;
+                woff <= 0;
+                pend <= 0;
+            end
+            else if (ADR_I[4:0] == 19)
+            begin
+                // Restart the pass so every channel starts a new average
+                declog <= DAT_I[2:0];
+                smplinx <= 0;
+                bitinx  <= 0;
+                espiinx <= 0;
+                round <= 0;
+            end
+            else if (ADR_I[4:0] == 20)
+            begin
+                // Restart the pass so every channel starts a new average
+                avgmask <= DAT_I[7:0];
+                smplinx <= 0;
+                bitinx  <= 0;
+                espiinx <= 0;
+                round <= 0;
+            end
         end
         else if (TGA_I & myaddr & (state == `ADCSNDRPLY))  // back to idle after the reply pkt read
         begin
@@ -123,7 +218,7 @@ module dpadc12(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pin
         end
 
         // Increment sample timer and switch state if time to sample
-        else if (m1clk)
+        else if (m1clk && (state != `ADCSTREAM))
         begin
             if (ratediv == smplrate)
             begin
@@ -159,6 +254,78 @@ module dpadc12(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pin
                 end
             end
         end 
+
+        // Streaming is the same ESPI sequence but skips channels not in
+        // the mask and restarts on the next channel after each sample.
+        else if (n100clk & (state == `ADCSTREAM))
+        begin
+            if ((bitinx == 0) && (espiinx == 0) && ~smask[smplinx])
+            begin
+                smplinx <= smplinx + 3'h1;
+                if (smplinx == 7)
+                    round <= (round == rndmax) ? 7'h00 : (round + 7'h01);
+            end
+            else if (espiinx != 5)
+            begin
+                espiinx <= espiinx + 3'h1;
+                if ((espiinx == 4) && (bitinx > 7))  // latch while sck high
+                    smpl <= {smpl[11:0], meta};
+            end
+            else
+            begin
+                espiinx <= 0;
+                if (bitinx != 20)
+                    bitinx <= bitinx + 5'h01;
+                else
+                begin
+                    bitinx <= 0;
+                    smplinx <= smplinx + 3'h1;
+                    if (smplinx == 7)
+                        round <= (round == rndmax) ? 7'h00 : (round + 7'h01);
+                    outval <= {smplinx, ((avgmask[smplinx]) ? accshft[12:0] : smpl)};
+                    if (~avgmask[smplinx] || (round == rndmax))
+                        wst <= 1;
+                end
+            end
+        end
+
+        // Hold the FIFO read for one clock for the synchronous RAM
+        stalled <= TGA_I & myaddr & ~WE_I & (state == `ADCSTREAM) & ~stalled;
+
+        // Free the block when the host reads its last byte
+        if (rdone)
+            pend <= 0;
+
+        // Write the sequence number and sample into the FIFO.  A full
+        // block goes to the host if the other block is free, else the
+        // block is overwritten and its sequence number is lost.
+        if (wst == 1)
+        begin
+            if (woff == 0)
+                woff <= 1;
+            wst <= 2;
+        end
+        else if (wst == 2)
+        begin
+            woff <= woff + 8'h01;
+            wst <= 3;
+        end
+        else if (wst == 3)
+        begin
+            if (woff == 254)
+            begin
+                woff <= 0;
+                seq <= seq + 8'h01;
+                if (~pend | rdone)
+                begin
+                    pend <= 1;
+                    wblk <= ~wblk;
+                end
+            end
+            else
+                woff <= woff + 8'h01;
+            wst <= 0;
+        end
     end
 
     // espi bit timing ....
@@ -174,8 +341,9 @@ module dpadc12(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pin
     //     miso =  x   x   x    x   x   x   x   0   d12 d11 d10 d9  d8  d7  d6  d5  d4  d3  d2  d1  d0  x
 
     // Assign the outputs.
-    assign a = (state == `ADCGETSMPL) & (espiinx == 4);
-    assign b = ~(espiinx == 1) & (state == `ADCGETSMPL);
+    assign active = (state == `ADCGETSMPL) | (state == `ADCSTREAM);
+    assign a = active & (espiinx == 4);
+    assign b = ~(espiinx == 1) & active;
     assign mosi = (espiinx < 3) ? (bitinx == 0) :
                   (bitinx == 1) ? 1'b1 :
                   (bitinx == 2) ? ~differ[smplinx] :
@@ -198,12 +366,26 @@ module dpadc12(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pin
     assign din[7] = ((state == `ADCGETSMPL) && ((bitinx == 13) || (bitinx == 05))) ? meta : dout[7];
     assign raddr = (state == `ADCGETSMPL) ? {smplinx[2:0],(bitinx > 12)} : ADR_I[3:0];
 
+    // Assign the streaming lines.  The accumulator restarts on round zero.
+    assign rndmax = ~(7'h7f << declog);
+    assign smplend = n100clk & (state == `ADCSTREAM) & (espiinx == 5) & (bitinx == 20) &
+                     ~(TGA_I & myaddr & WE_I);
+    assign accsum = ((round == 0) ? 20'h00000 : accout) + {{7{smpl[12]}}, smpl};
+    assign accshft = accsum >> declog;
+    assign fwe = ((wst == 1) && (woff == 0)) || (wst == 2) || (wst == 3);
+    assign fwa = {wblk, ((wst == 1) ? 8'h00 : woff)};
+    assign fwd = (wst == 1) ? seq :
+                 (wst == 2) ? outval[15:8] : outval[7:0];
+    assign rdone = TGA_I & myaddr & ~WE_I & (state == `ADCSTREAM) & stalled & (ADR_I == 254);
+
     // Assign the bus control lines
-    assign myaddr = (STB_I) && (ADR_I[7:5] == 0);
+    assign myaddr = (STB_I) && ((ADR_I[7:5] == 0) || ((state == `ADCSTREAM) && ~WE_I));
     assign DAT_O = (~myaddr) ? DAT_I :
+                    (~TGA_I & (state == `ADCSTREAM) & pend) ? 8'hff :  // a full block
                     (~TGA_I & (state == `ADCSNDRPLY)) ? 8'h10 :  // all replies have 16 bytes
+                    (TGA_I & (state == `ADCSTREAM)) ? frd :
                     (TGA_I) ? dout : 8'h00 ; 
-    assign STALL_O = 0;
+    assign STALL_O = TGA_I & myaddr & ~WE_I & (state == `ADCSTREAM) & ~stalled;
     assign ACK_O = myaddr;
 
 endmodule
@@ -227,3 +409,49 @@ module dpadcram16x8(dout,addr,din,wclk,wen);
     assign dout = ram[addr];
 
 endmodule
+
+
+module dpadcacc8x20(dout,addr,din,wclk,wen);
+    output   [19:0] dout;
+    input    [2:0] addr;
+    input    [19:0] din;
+    input    wclk;
+    input    wen;
+
+    reg      [19:0] ram [7:0];
+
+    always@(posedge wclk)
+    begin
+        if (wen)
+            ram[addr] <= din;
+    end
+
+    assign dout = ram[addr];
+
+endmodule
+
+
+//
+// Sample FIFO Dual-Port RAM with synchronous Read
+//
+module dpadcfifo(CLK_I,we,wa,wd,ra,rd);
+    input    CLK_I;                         // system clock
+    input    we;                            // write enable
+    input    [8:0] wa;                      // write address
+    input    [7:0] wd;                      // write data
+    input    [8:0] ra;                      // read address
+    output   [7:0] rd;                      // read data
+
+    reg      [7:0] rdreg;
+    reg      [7:0] ram [511:0];
+
+    always@(posedge CLK_I)
+    begin
+        if (we)
+            ram[wa] <= wd;
+        rdreg <= ram[ra];
+    end
+
+    assign rd = rdreg;
+
+endmodule
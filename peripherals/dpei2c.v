@@ -29,34 +29,59 @@
 
 //////////////////////////////////////////////////////////////////////////
 //
-//  File: dpei2c.v;   General purpose I2C interface for up to 64 bit commands
+//  File: dpei2c.v;   Queued I2C master with a periodic scan list
 //
-//  Registers: 8 bit, read-write
-//      Reg 0:  Bits 1/0 are the type of bit time as follows:
-//                   0/0 Write a data bit of zero to the target I2C device
-//                   0/1 Write a one or let the device write the bit value
-//                   1/0 Start bit
-//                   1/1 Stop bit
-//              Bits 7/6 specify the clock frequency as:
+//  Registers: 8 bit
+//      Reg 0-127: Results of the last run of the command queue (read only)
+//      Reg 128:   Control.  Bits 1/0 specify the clock frequency as:
 //                   0/0 10 KHz
 //                   0/1 100 KHz
 //                   1/0 400 KHz
 //                   1/1 1 MHz
-//      Reg 1-31: Bits 0 to 1 as above.  Bits 6 and 7 are ignored.
+//                 Writing a one to bit 4 runs the command queue once
+//                 if it is not already running.
+//                 Bit 5 enables scan mode which runs the queue periodically.
+//      Reg 129:   Scan period in milliseconds, zero indexed
+//      Reg 130:   Command queue address for the next write to reg 131
+//      Reg 131:   Command queue data.  Writes increment the queue address.
+//      Reg 132:   Status.  Bit 7 is set while the queue is running and
+//                 bit 6 is set while results are waiting for the host.
 //
+//  Commands: The command queue is 256 bytes of RAM loaded by the host.
+//      0x00       End of the queue.  Send the results to the host
+//      0x01       Start or repeated start bit
+//      0x02       Stop bit
+//      0x40-0x7f  Write 1 to 64 bytes.  The low 6 bits are the count less
+//                 one.  The bytes to write follow the command.
+//      0x80-0xbf  Read 1 to 64 bytes.  The low 6 bits are the count less
+//                 one.  All but the last byte are ACKed.
+//      Other commands are treated as an end of the queue.
 //
-//  HOW THIS WORKS
-//      Each register visible to the host controls a single bit time
-//  on the I2C bus.  Once the host has written all of the registers
-//  it needs, the FPGA plays out the bits on the SDA and SCL lines.
-//  The value for bit reads are written into Bit 0 of the register
-//  for that bit time.
+//  Results: Byte 0 is a sequence number that increments on each run of
+//  the queue.  Byte 1 is the number of NACKs in bits 0-6 and bit 7 is set
+//  if a slave held SCL low for more than 25 ms.  The bytes read by the
+//  read commands follow in the order they are read.  The results are
+//  autosent to the host at the end of each run.  Results past 128 bytes
+//  are lost.
 //
-//  Start bits can occur more than once in a packet.  We use a stop
-//  bit to indicate the end of a packet.  A data bit of one is either
-//  a write of one or a read from the target I2C device since it can
-//  pull the SDA line low if needed.  Either way we latch the SDA
-//  value into Bit 0 to send back to the host as a reply.
+//  HOW THIS WORKS
+//      The host loads a list of transactions into the command queue once.
+//  A write to bit 4 of the control register, or the scan timer in scan
+//  mode, starts a run of the queue from address 0.  The queue engine reads
+//  each command and plays out the start, stop, and data bits of each byte
+//  on the SDA and SCL lines.  A write byte is eight data bits followed by
+//  an ACK bit read from the slave.  A read byte is eight bits read from
+//  the slave followed by an ACK or NACK from the FPGA.  A NACK from the
+//  slave aborts the rest of that transaction.  The engine skips to the
+//  next stop command and fills the results of skipped reads with 0xff so
+//  the results of other transactions stay at the same offsets.
+//      The results are kept in two blocks.  The engine fills one block
+//  while the other waits for the host.  If the host has not read the last
+//  block when a run ends, the new results are dropped but the sequence
+//  number still increments so the host can detect the lost scan.  A scan
+//  period that ends while the queue is still running is skipped, as is
+//  a write of bit 4 during a run.  The host should turn off scan mode
+//  before changing the command queue.
 //
 //  Each I2c bit is broken into 4 quarter bits.  The bit quarter is
 //  stored in bq (bit quarter) and goes from 0 to 3.  More details are
@@ -153,6 +178,22 @@
 //
 //                        
 /////////////////////////////////////////////////////////////////////////
+
+// Queue engine states
+`define EI2CIDLE     4'h0    // Waiting for a run or scan
+`define EI2CFETCH    4'h1    // Wait for the command from the queue RAM
+`define EI2CDECODE   4'h2    // Start processing the command
+`define EI2CSTART    4'h3    // Wait for the start bit
+`define EI2CSTOP     4'h4    // Wait for the stop bit
+`define EI2CWRLD     4'h5    // Wait for a write byte from the queue RAM
+`define EI2CWRBYTE   4'h6    // Start the bits of a write byte
+`define EI2CWRBIT    4'h7    // Do the bits and ACK of a write byte
+`define EI2CFILL     4'h8    // Fill results of a skipped read
+`define EI2CRDBIT    4'h9    // Do the bits and ACK of a read byte
+`define EI2CHDR0     4'ha    // Write the sequence number to the results
+`define EI2CHDR1     4'hb    // Write the NACK count to the results
+`define EI2CDONE     4'hc    // Send the results to the host
+
 module dpei2c(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins);
     input  CLK_I;            // System clock
     input  WE_I;             // direction of this transfer. Read=0; Write=1
@@ -166,114 +207,366 @@ module dpei2c(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins
     input  [`MXCLK:0] clocks; // Array of clock pulses from 10ns to 1 second
     inout  [3:0] pins;       // FPGA I/O pins
 
+    wire m1clk   =  clocks[`M1CLK];      // utility 1.000 millisecond pulse
+    wire u100clk =  clocks[`U100CLK];    // utility 100.0 microsecond pulse
+
     assign pins[0] = pin2;   // D input to both 7474 flip-flops
     assign pins[1] = pin4;   // Clock input on flip-flop for the SDA line
     assign pins[2] = pin6;   // Clock input on flip-flop for the SCL line
     wire   pin8 = pins[3];   // SDA input
 
-    // State variables
-    reg    [2:0] smctr;      // State machine to control 7474 D and clk inputs
+    // Bit engine state
     reg    [1:0] bq;         // Bit quarter 
-    reg    [6:0] bix;        // Packet bit index 
-    reg    inxfer;           // set=1 if doing a transfer (set on end of packet stop bit)
-    reg    dataready;        // set=1 to wait for an autosend to host
-    reg    [5:0] clkdiv;     // divides 100 ns clock to get 1.6 MHz (about) for quarter bits
-    reg    clkrate;          // ==1 for 400 KHz and 0 for 100 KHz
+    reg    [8:0] clkdiv;     // divides system clock to get quarter bits
+    reg    [1:0] clksel;     // 10K, 100K, 400K, or 1M bits per second
+    reg    inbit;            // ==1 while playing out the bit in btype
+    reg    bitdone;          // ==1 for one clock at the end of a bit
+    reg    [1:0] btype;      // 00/01 data bit, 10 start bit, 11 stop bit
+    reg    sda;              // SDA as sampled in the last data bit
+    reg    meta,pin8s;       // pin8 in our clock domain
+    reg    [7:0] sttmr;      // time SCL has been stretched in units of 100 us
+    wire   [8:0] divmax;     // last count of clkdiv in a quarter bit
+    wire   stretch;          // ==1 while a slave holds SCL low
     wire   bqclk;            // ==1 on clock edge of quarter bit transitions
     wire   bqstart;          // in start of the quarter bit
     wire   start_bit;        // ==1 if in a start bit
     wire   data_bit;         // ==1 if in a data bit
     wire   stop_bit;         // ==1 if in a stop bit
 
+    // Queue engine state
+    reg    [3:0] est;        // queue engine state
+    reg    [7:0] qaddr;      // address of the next command or write byte
+    reg    [5:0] nbytes;     // bytes left in this command after this one
+    reg    [3:0] bitcnt;     // bit in the byte, 8 is the ACK bit
+    reg    [7:0] shreg;      // byte being written or read
+    reg    skip;             // ==1 to skip to the next stop after a NACK
+    reg    [6:0] nackcnt;    // NACKs in this run
+    reg    tmo;              // ==1 if SCL stretching timed out in this run
+    reg    [7:0] resptr;     // offset of the next result byte
+    reg    [7:0] seq;        // run sequence number
+    reg    gopend;           // ==1 to start a run when idle
+    reg    scan;             // ==1 to run the queue every scan period
+    reg    [7:0] period;     // scan period in ms, zero indexed
+    reg    [7:0] mscnt;      // scan period counter
+    reg    wblk;             // result block being filled.  ~wblk is sent to host
+    reg    pend;             // ==1 if block ~wblk is waiting for the host
+    reg    [7:0] rlen;       // number of bytes in block ~wblk
+    reg    stalled;          // ==1 on second clock of a result read
+
     // Addressing and bus interface lines 
     wire   myaddr;           // ==1 if a correct read/write on our address
+    wire   rdone;            // ==1 when the host reads the last result byte
 
-    // RAM for the I2C packet
-    wire   [1:0] rout;       // RAM output lines
-    wire   [6:0] raddr;      // RAM address lines
-    wire   [1:0] rin;        // RAM input lines
-    wire   wen;              // RAM write enable
-    // RAM is broken into two 64x3 blocks
-    wire   wen0;             // write enable for lower block
-    wire   rout0[1:0];       // ram output lines
-    ram64x1ei2c ram00(rout0[0],raddr[5:0],rin[0],CLK_I,wen0); // i2c bit info as an array
-    ram64x1ei2c ram01(rout0[1],raddr[5:0],rin[1],CLK_I,wen0); // i2c bit info as an array
-    wire   wen1;             // write enable for upper block
-    wire   rout1[1:0];       // ram output lines
-    ram64x1ei2c ram10(rout1[0],raddr[5:0],rin[0],CLK_I,wen1); // i2c bit info as an array
-    ram64x1ei2c ram11(rout1[1],raddr[5:0],rin[1],CLK_I,wen1); // i2c bit info as an array
+    // Command queue RAM.  Host writes, engine reads.
+    reg    [7:0] qptr;       // host write address
+    wire   qwe;              // queue write enable
+    wire   [7:0] qrd;        // queue read data
+    ei2cram256x8 qram(CLK_I,qwe,qptr,DAT_I,qaddr,qrd);
+
+    // Results RAM.  Engine writes, host reads.
+    wire   rwe;              // results write enable
+    wire   [7:0] rwa;        // results write address
+    wire   [7:0] rwd;        // results write data
+    wire   [7:0] rrd;        // results read data
+    ei2cram256x8 rram(CLK_I,rwe,rwa,rwd,{~wblk,ADR_I[6:0]},rrd);
 
 
     initial
     begin
         bq = 0;
-        bix = 0;
-        dataready = 0;
-        inxfer = 0;
-        clkrate = 1;           // default is 400 KHz
+        clkdiv = 0;
+        clksel = 2;            // default is 400 KHz
+        inbit = 0;
+        bitdone = 0;
+        btype = 0;
+        sttmr = 0;
+        est = `EI2CIDLE;
+        qaddr = 0;
+        skip = 0;
+        nackcnt = 0;
+        tmo = 0;
+        resptr = 0;
+        seq = 0;
+        gopend = 0;
+        scan = 0;
+        period = 99;           // scan every 100 ms
+        mscnt = 0;
+        wblk = 0;
+        pend = 0;
+        rlen = 0;
+        stalled = 0;
+        qptr = 0;
     end
 
     always @(posedge CLK_I)
     begin
+        // Bring pin8 into our clock domain
+        meta <= pin8;
+        pin8s <= meta;
 
-        // Do 400/100 clock rate division from system clock.
-        // But only if we are not doing SCL clock stretching
-        //if (~(~pin8 & data_bit & (bq == 1) & (clkdiv == 1)))
+        // Handle writes from the host
+        if (TGA_I && WE_I && myaddr)
         begin
-            if ((clkrate && (clkdiv == 12)) || (~clkrate && (clkdiv == 48)))
-                clkdiv <= 0;
-            else
-                clkdiv <= clkdiv + 6'h01;
+            if (ADR_I[2:0] == 0)
+            begin
+                clksel <= DAT_I[1:0];
+                scan <= DAT_I[5];
+                if (DAT_I[4] && (est == `EI2CIDLE))
+                    gopend <= 1;
+            end
+            else if (ADR_I[2:0] == 1)
+                period <= DAT_I;
+            else if (ADR_I[2:0] == 2)
+                qptr <= DAT_I;
+            else if (ADR_I[2:0] == 3)
+                qptr <= qptr + 8'h01;
         end
 
-        // reading the register for the last i2c bit clears the dataready flag
-        if (TGA_I && ~WE_I && myaddr && ((ADR_I[6:0] == (bix -1)) || (ADR_I[6:0] == 7'h7f)))
+        // Start a run every scan period.  Skip the period if still running.
+        if (scan && m1clk)
         begin
-            dataready <= 0;
+            if (mscnt >= period)
+            begin
+                mscnt <= 0;
+                if (est == `EI2CIDLE)
+                    gopend <= 1;
+            end
+            else
+                mscnt <= mscnt + 8'h01;
         end
 
-        // else look for first bit which had the clock rate in bit 7.
-        if (TGA_I && WE_I && myaddr && (ADR_I[6:0] == 0))
+        // Hold the result read for one clock for the synchronous RAM
+        stalled <= TGA_I & myaddr & ~WE_I & ~ADR_I[7] & ~stalled;
+
+        // Free the result block when the host reads its last byte
+        if (rdone)
+            pend <= 0;
+
+        // Bit engine.  Play out one start, stop, or data bit as four
+        // quarter bits.  Pause in the second quarter of a data bit while
+        // the slave holds SCL low.
+        bitdone <= 0;
+        if (inbit)
         begin
-            clkrate <= DAT_I[7];
-        end
+            if (stretch)
+            begin
+                if (u100clk)
+                    sttmr <= sttmr + 8'h01;
+            end
+            else if (clkdiv == divmax)
+                clkdiv <= 0;
+            else
+                clkdiv <= clkdiv + 9'h001;
 
-        // else look for end of packet (host is writing stop bit)
-        if (TGA_I && WE_I && myaddr && (DAT_I[1:0] == 2'b11))
+            if (data_bit && (bq == 1) && (clkdiv == 1) && (sttmr == 250))
+                tmo <= 1;
+
+            if (bqclk)
+            begin
+                bq <= bq + 2'h1;
+                if (data_bit && (bq == 2))
+                    sda <= ~pin8s;
+                if (bq == 3)
+                begin
+                    inbit <= 0;
+                    bitdone <= 1;
+                end
+            end
+        end
+        else
         begin
-            inxfer <= 1;       // Got packet from host, so start the i2c transfer
-            clkdiv <= 0;       // reset clkdiv at start of bits
-            bix <= 0;          // Start with bit zero
-            bq <= 0;           // And sub-bit state of zero
+            bq <= 0;
+            clkdiv <= 0;
+            sttmr <= 0;
         end
 
-        // else if host is not rd/wr our regs and we're in an i2c transfer
-        // and we're on a state machine edge 
-        else if (~(TGA_I & myaddr & WE_I) & bqclk & inxfer)
+        // Queue engine
+        if (est == `EI2CIDLE)
         begin
-            // Increment quarter bit state
-            bq <= bq + 2'h1;
-
-            if (bq == 3)
+            if (gopend)
             begin
-                bix <= bix + 7'h01;
-
-                // A stop bit marks the end of a packet
-                if (rout[1:0] == 2'b11)
+                gopend <= 0;
+                qaddr <= 0;
+                resptr <= 2;       // results start after the header
+                nackcnt <= 0;
+                tmo <= 0;
+                skip <= 0;
+                est <= `EI2CFETCH;
+            end
+        end
+        else if (est == `EI2CFETCH)
+            est <= `EI2CDECODE;
+        else if (est == `EI2CDECODE)
+        begin
+            qaddr <= qaddr + 8'h01;
+            nbytes <= qrd[5:0];
+            if (qrd == 8'h01)                  // start bit
+            begin
+                if (skip)
+                    est <= `EI2CFETCH;
+                else
+                begin
+                    btype <= 2'b10;
+                    est <= `EI2CSTART;
+                    inbit <= 1;
+                end
+            end
+            else if (qrd == 8'h02)             // stop bit ends a skip
+            begin
+                btype <= 2'b11;
+                est <= `EI2CSTOP;
+                skip <= 0;
+                inbit <= 1;
+            end
+            else if (qrd[7:6] == 2'b01)        // write bytes
+            begin
+                if (skip)
                 begin
-                    dataready <= 1;
-                    inxfer <= 0;
+                    qaddr <= qaddr + {2'h0, qrd[5:0]} + 8'h02;
+                    est <= `EI2CFETCH;
                 end
+                else
+                    est <= `EI2CWRLD;
             end
+            else if (qrd[7:6] == 2'b10)        // read bytes
+            begin
+                if (skip)
+                    est <= `EI2CFILL;
+                else
+                begin
+                    bitcnt <= 0;
+                    btype <= 2'b01;
+                    est <= `EI2CRDBIT;
+                    inbit <= 1;
+                end
+            end
+            else                               // end of queue
+                est <= `EI2CHDR0;
+        end
+        else if ((est == `EI2CSTART) || (est == `EI2CSTOP))
+        begin
+            if (bitdone)
+                est <= `EI2CFETCH;
+        end
+        else if (est == `EI2CWRLD)
+            est <= `EI2CWRBYTE;
+        else if (est == `EI2CWRBYTE)
+        begin
+            qaddr <= qaddr + 8'h01;
+            shreg <= qrd;
+            bitcnt <= 0;
+            btype <= {1'b0, qrd[7]};
+            est <= `EI2CWRBIT;
+            inbit <= 1;
+        end
+        else if (est == `EI2CWRBIT)
+        begin
+            if (bitdone)
+            begin
+                bitcnt <= bitcnt + 4'h1;
+                if (bitcnt < 7)                // next data bit
+                begin
+                    shreg <= {shreg[6:0], 1'b0};
+                    btype <= {1'b0, shreg[6]};
+                    inbit <= 1;
+                end
+                else if (bitcnt == 7)          // let the slave drive the ACK
+                begin
+                    btype <= 2'b01;
+                    inbit <= 1;
+                end
+                else if (sda)                  // NACK.  Skip to the stop
+                begin
+                    if (nackcnt != 7'h7f)
+                        nackcnt <= nackcnt + 7'h01;
+                    skip <= 1;
+                    qaddr <= qaddr + {2'h0, nbytes};
+                    est <= `EI2CFETCH;
+                end
+                else if (nbytes == 0)
+                    est <= `EI2CFETCH;
+                else
+                begin
+                    nbytes <= nbytes - 6'h01;
+                    est <= `EI2CWRLD;
+                end
+            end
+        end
+        else if (est == `EI2CFILL)
+        begin
+            if (resptr[7] == 0)
+                resptr <= resptr + 8'h01;
+            if (nbytes == 0)
+                est <= `EI2CFETCH;
+            else
+                nbytes <= nbytes - 6'h01;
+        end
+        else if (est == `EI2CRDBIT)
+        begin
+            if (bitdone)
+            begin
+                bitcnt <= bitcnt + 4'h1;
+                if (bitcnt < 8)
+                    shreg <= {shreg[6:0], sda};
+                if (bitcnt < 7)                // next data bit
+                begin
+                    btype <= 2'b01;
+                    inbit <= 1;
+                end
+                else if (bitcnt == 7)          // ACK all but the last byte
+                begin
+                    btype <= (nbytes == 0) ? 2'b01 : 2'b00;
+                    inbit <= 1;
+                end
+                else
+                begin
+                    if (resptr[7] == 0)
+                        resptr <= resptr + 8'h01;
+                    if (nbytes == 0)
+                        est <= `EI2CFETCH;
+                    else
+                    begin
+                        nbytes <= nbytes - 6'h01;
+                        bitcnt <= 0;
+                        btype <= 2'b01;
+                        inbit <= 1;
+                    end
+                end
+            end
+        end
+        else if (est == `EI2CHDR0)
+            est <= `EI2CHDR1;
+        else if (est == `EI2CHDR1)
+            est <= `EI2CDONE;
+        else
+        begin
+            // Send the results if the host has read the last block
+            seq <= seq + 8'h01;
+            if (~pend | rdone)
+            begin
+                pend <= 1;
+                rlen <= resptr;
+                wblk <= ~wblk;
+            end
+            est <= `EI2CIDLE;
         end
     end
 
 
     // Assign the outputs.
-    assign bqstart = (clkdiv[5:2] == 0) ;
-    assign start_bit = inxfer && (rout[1:0] == 2'b10) ;
-    assign data_bit  = inxfer && (rout[1] == 0) ;
-    assign stop_bit  = inxfer && (rout[1:0] == 2'b11) ;
+    assign divmax = (clksel == 0) ? 9'd499 :   // 10 KHz
+                    (clksel == 1) ? 9'd49 :    // 100 KHz
+                    (clksel == 2) ? 9'd12 :    // 400 KHz
+                    9'd4;                      // 1 MHz
+    assign bqstart = (clkdiv[8:2] == 0) ;
+    assign bqclk = inbit && (clkdiv == divmax);
+    assign start_bit = inbit && (btype == 2'b10) ;
+    assign data_bit  = inbit && (btype[1] == 0) ;
+    assign stop_bit  = inbit && (btype == 2'b11) ;
+
+    // pin8 is high while SCL is selected and held low.  The synchronizer
+    // adds a couple of clocks to every data bit.
+    assign stretch = data_bit && (bq == 1) && (clkdiv == 1) && pin8s && (sttmr != 250);
 
     //  Pin2 = D input = 1 if (start_bit & bq >= 2)  OR
     //                        (data_bit & data==0 & bq==0) OR
@@ -281,7 +574,7 @@ module dpei2c(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins
     //                        (data_bit & bq==3) OR
     //                        (stop_bit & bq==0)
     assign pin2 = (start_bit && (bq[1] == 1)) ||
-                  (data_bit && bqstart && (rout[0] == 0) && (bq == 0)) ||
+                  (data_bit && bqstart && (btype[0] == 0) && (bq == 0)) ||
                   (data_bit && (bq == 2)) ||
                   (data_bit && (bq == 3)) ||
                   (stop_bit && bqstart && (bq ==0));
@@ -309,53 +602,59 @@ module dpei2c(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins
                   (stop_bit && bqstart && (bq == 1) && (clkdiv[1:0] == 1));
 
 
-    assign bqclk = (clkrate && (clkdiv == 12)) || (~clkrate && (clkdiv == 48));
-
     // assign RAM signals
-    assign wen0  = (raddr[6] == 0) &&
-                   ((TGA_I & myaddr & WE_I) ||  // latch data on host write OR
-                   (data_bit && bqstart && (bq == 2))); // i2c read/write
-    assign wen1  = (raddr[6] == 1) &&
-                   ((TGA_I & myaddr & WE_I) ||  // latch data on host write OR
-                   (data_bit && bqstart && (bq == 2))); // i2c read/write
-    assign rout[0]  = (raddr[6] == 0) ? rout0[0] : rout1[0];
-    assign rout[1]  = (raddr[6] == 0) ? rout0[1] : rout1[1];
-    assign raddr = (TGA_I & myaddr) ? ADR_I[6:0] : bix ;
-    assign rin[1] = (TGA_I & myaddr & WE_I) ? DAT_I[1] : rout[1];
-    assign rin[0] = (TGA_I & myaddr & WE_I) ? DAT_I[0] :
-                    (inxfer && (rout[1] == 0) && (bq == 2)) ? ~pin8 : rout[0];
-
-
-    assign myaddr = (STB_I) && (ADR_I[7] == 0);
+    assign qwe = TGA_I & myaddr & WE_I & (ADR_I[7] == 1) & (ADR_I[2:0] == 3);
+    assign rwe = (est == `EI2CHDR0) || (est == `EI2CHDR1) ||
+                 ((est == `EI2CFILL) && (resptr[7] == 0)) ||
+                 ((est == `EI2CRDBIT) && bitdone && (bitcnt == 8) && (resptr[7] == 0));
+    assign rwa = {wblk, ((est == `EI2CHDR0) ? 7'h00 :
+                         (est == `EI2CHDR1) ? 7'h01 : resptr[6:0])};
+    assign rwd = (est == `EI2CHDR0) ? seq :
+                 (est == `EI2CHDR1) ? {tmo, nackcnt} :
+                 (est == `EI2CFILL) ? 8'hff : shreg;
+    assign rdone = TGA_I & myaddr & ~WE_I & ~ADR_I[7] & stalled & pend &
+                   (ADR_I == (rlen - 8'h01));
+
+
+    // Registers 0-127 are the read only results.  128-132 are control.
+    assign myaddr = (STB_I) && (((ADR_I[7] == 0) && (~WE_I || ~TGA_I)) || (ADR_I[7:3] == 5'h10));
     assign DAT_O = (~myaddr) ? DAT_I :
-                    (~TGA_I && myaddr && (dataready)) ? {1'h0, (bix)} :
-                    (TGA_I) ? {6'h00,rout} : 
+                    (~TGA_I) ? ((pend) ? rlen : 8'h00) :
+                    (ADR_I[7] == 0) ? rrd :
+                    (ADR_I[2:0] == 0) ? {2'h0, scan, 3'h0, clksel} :
+                    (ADR_I[2:0] == 1) ? period :
+                    (ADR_I[2:0] == 2) ? qptr :
+                    (ADR_I[2:0] == 4) ? {(est != `EI2CIDLE), pend, 6'h00} :
                     8'h00 ; 
 
-    // Loop in-to-out where appropriate
-    assign STALL_O = 0;
+    // Hold a result read one clock for the synchronous RAM
+    assign STALL_O = TGA_I & myaddr & ~WE_I & ~ADR_I[7] & ~stalled;
     assign ACK_O = myaddr;
 
 endmodule
 
 
-
-module ram64x1ei2c(dout,addr,din,wclk,wen);
-    output   dout;
-    input    [5:0] addr;
-    input    din;
-    input    wclk;
-    input    wen;
-
-    reg      ram [63:0];
-
-    always@(posedge wclk)
+//
+// Dual-Port RAM with synchronous Read for the command queue and results
+//
+module ei2cram256x8(CLK_I,we,wa,wd,ra,rd);
+    input    CLK_I;                         // system clock
+    input    we;                            // write enable
+    input    [7:0] wa;                      // write address
+    input    [7:0] wd;                      // write data
+    input    [7:0] ra;                      // read address
+    output   [7:0] rd;                      // read data
+
+    reg      [7:0] rdreg;
+    reg      [7:0] ram [255:0];
+
+    always@(posedge CLK_I)
     begin
-        if (wen)
-            ram[addr] <= din;
+        if (we)
+            ram[wa] <= wd;
+        rdreg <= ram[ra];
     end
 
-    assign dout = ram[addr];
+    assign rd = rdreg;
 
 endmodule
-
@@ -119,6 +119,7 @@ struct PDESC pdesc[] = {
     {"tonegen", 45, "tonegen", 0xf, 4 },
     {"stpxo2", 46, "stpxo2", 0x0, 0 },
     {"basys3", 47, "basys3", 0x0, 0 },
+    {"dcpid", 48, "dcpid", 0x3, 4 },
 };
 
 #define NPERI (sizeof(pdesc) / sizeof(struct PDESC))
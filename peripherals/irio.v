@@ -32,18 +32,34 @@
 //  File: irio.v;   IR receiver / transmitter
 //
 //  Registers: (8 bit)
-//      Reg 0:  IR data bit in bit 0
-//      Reg 1:  IR data bit in bit 0
-//      Reg 2:  IR data bit in bit 0
-//      Reg 3:  IR data bit in bit 0
-//      :::::::::::::::::::::::::::::::::::::::::
-//      Reg 30: IR data bit in bit 0
-//      Reg 31: IR data bit in bit 0
+//      Reg 0-63: Receive FIFO.  Received codes are four byte records.
+//              Registers are read in order and a read of the fourth byte
+//              of a record (low two address bits == 3) removes the record.
+//      Reg 64: Transmit protocol and flags.  Same format as record byte 0
+//      Reg 65: Transmit address high byte
+//      Reg 66: Transmit address low byte
+//      Reg 67: Transmit command.  A write starts the transmission
+//      Reg 68: Receive configuration.  Bit 7 set for raw timing capture.
+//              Bits 0-3 enable the NEC, RC5, RC6, and SIRC decoders.
+//      Reg 69: Status.  Bit 7 is set while transmitting.  Bits 0-4 are
+//              the number of records in the receive FIFO.
 //
-//      There are up to 32 bits of IR packet data.
-//      The configuration register is just the high bit of register 32.
-//  It indicates the value of the input while an IR signal is being
-//  received.
+//  Records: (4 bytes)
+//      Byte 0: Protocol in bits 7-4: 0=raw, 1=NEC, 2=RC5, 3=RC6, 4=SIRC.
+//              Bit 0 is the NEC repeat code flag or the RC5/RC6 toggle bit.
+//              Bits 2-1 are the SIRC length: 0=12 bits, 1=15 bits, 2=20.
+//              Bit 3 is the level of a raw record, 1=IR present.
+//      Byte 1: Address high byte, or high byte of a raw duration
+//      Byte 2: Address low byte, or low byte of a raw duration
+//      Byte 3: Command, or zero for a raw record
+//
+//      NEC addresses are the first two bytes received with the first byte
+//  in the low byte.  The command is checked against its complement.
+//  RC5 addresses are 5 bits and commands are 7 bits with the inverted
+//  second start bit as bit 6.  RC6 is mode 0 only with an 8 bit address
+//  and an 8 bit command.  SIRC commands are 7 bits with 5, 8, or 13 bit
+//  addresses.  A raw record has the duration of one mark or space in
+//  units of 10 microseconds.  Durations saturate at 40.95 ms.
 //
 //  Hardware:
 //      The first pin is the output to the Rx Activity LED.  The second
@@ -53,37 +69,43 @@
 //
 //
 //  HOW THIS WORKS : Receiver
-//      The input is sampled every 200 microseconds.  When idle the circuit
-//  is waiting for a AGC pulse of at least 8 ms followed by an off time of
-//  at least 1.8 milliseconds.  If both of these conditions are met the
-//  circuit starts taking reading of the "off" intervals. A reading is the
-//  count (units of 200 us) of the duration of the off time.  Each reading
-//  is resolved to a one or a zero depending on whether or not it is longer
-//  than 1 millisecond.  The bit is put into a shift register and the "bit
-//  count" is incremented by one.  The IR packet is considered complete if
-//  the signal is off for more that 5 milliseconds.  The "data ready" flag
-//  is set to indicate that a full packet is ready to be sent to the host.
-//      The states of the receiver are "waiting for AGC". "in AGC", in 
-//  "pause", and in "samples".
+//      The input is sampled every 10 microseconds.  At each change of the
+//  input the front end gives the decoders an event with the level and
+//  duration of the mark or space that just ended.  A space of more than
+//  8 ms ends any frame in progress.  The decoders run in parallel and
+//  each accepts a duration within 25 percent of its nominal value.
+//      NEC and SIRC are pulse distance and pulse width codes and are
+//  decoded as a sequence of mark/space pairs.  A NEC repeat code is only
+//  reported if it comes within 120 ms of the last NEC frame or repeat code
+//  and there has been no transmit in between.  RC5 and RC6 are Manchester
+//  codes.  Their decoder tracks the position of each event in half bit
+//  slots and takes the value of a bit from the level of its first half.
+//      Decoded records, or raw mark/space records in raw mode, go into a
+//  sixteen record FIFO that is autosent to the host.  Records are lost if
+//  the FIFO is full.  The receiver input is ignored during a transmission.
 //
 //  HOW THIS WORKS : Transmitter
-//      Any write from the host forces the receiver into a "waiting for AGC"
-//  state which effectively aborts any receive in progress.  This prevents
-//  sending to the host a receive packet that has been corrupted by bits
-//  from a send packet.  (Receiver and transmitter share the same RAM).
-//  The receiver input is ignored during an IR transmission.
-//      On receipt of a write to bit 31 the transmitter turns on "inxmit"
-//  and enters the "sending AGC" state which sends 9 milliseconds of signal
-//  at 38 KHz.  At the end of the the AGC pulse the transmitter enters "in
-//  xmit pause", a 4.4 ms pause with the IR LEDs off.  At the end of the
-//  pause the transmits enters the "in xmit bits" state which sends each
-//  of the 32 bits in the RAM.  After the bits are send, the transmitter
-//  goes to the "send trailing bit" state which defines the off time for the
-//  last bit in the packet.
-//      The IR clock is two cycles (high, then low) of a 13 microsecond 
-//  counter.
+//      A write to register 67 loads the bits of the frame into a shift
+//  register and starts the transmit state machine.  The states are "start",
+//  "header mark", "header space", "first half of bit", "second half of bit",
+//  "trailer", and a 10 ms "quiet time" at the end of the frame.  Each state
+//  loads a timer in units of 10 microseconds.  A NEC record with the repeat
+//  flag set sends a NEC repeat code.  The RC5/RC6 toggle bit comes from bit
+//  0 of register 64.
+//      The carrier is 38 KHz for NEC, 40 KHz for SIRC, and 36 KHz for RC5
+//  and RC6, with a 50 percent duty cycle.
 //
 /////////////////////////////////////////////////////////////////////////
+
+`define IRRAW      4'h0
+`define IRNEC      4'h1
+`define IRRC5      4'h2
+`define IRRC6      4'h3
+`define IRSIRC     4'h4
+`define IRGAP      12'd800   // 8 ms of space ends a frame
+`define IRNECRPT   7'd120    // ms to wait for a NEC repeat code
+
+
 module irio(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins);
     input  CLK_I;            // system clock
     input  WE_I;             // direction of this transfer. Read=0; Write=1
@@ -97,294 +119,651 @@ module irio(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins);
     input  [`MXCLK:0] clocks; // Array of clock pulses from 10ns to 1 second
     inout  [3:0] pins;       // FPGA I/O pins
 
-    wire u100clk =  clocks[`U100CLK];    // utility 100.0 microsecond pulse
-    wire u1clk   =  clocks[`U1CLK];      // utility 1.000 microsecond pulse
+    wire u10clk  =  clocks[`U10CLK];     // utility 10.00 microsecond pulse
+    wire m1clk   =  clocks[`M1CLK];      // utility 1.000 millisecond pulse
     assign pins[0] = rxled;  // Set low when we're getting a packet
     assign pins[1] = txled;  // Set low when sending a packet
     assign pins[2] = irout;  // Controls the IR LEDs.  Low=on
     wire   irin = pins[3];   // Data from the IR receiver
 
-    // IR pulse width registers and lines
-    reg    in0;              // The value of the IR input but in our clock domain
-    reg    [5:0] main;       // Main pulse width comparison clock
-    reg    pclk;             // Period clock (200 us)
-    reg    [5:0] count;      // Count of bits received after AGC/pause
-    reg    [1:0] state;      // receiver: wait agc, in agc, in pause, in data
-                             // transmitter: agc, agc pause, data, data trailing bit
-    reg    inone;            // sub-state to the "in data" state.
-    reg    data_ready;       // ==1 if a packet is ready for the host
-    reg    inxmit;           // ==1 if we are transmitting an IR packet
-    reg    [3:0] c76k;       // 76 KHz clock (about)
-    reg    c38k;             // 38.4 KHz clock (about)
-
     // Addressing, bus interface, and spare I/O lines and registers
     wire   myaddr;           // ==1 if a correct read/write on our address
 
-    // Registers for Rx and Tx data
-    wire   rxout;            // Rx RAM output line
-    wire   [4:0] rxaddr;     // Rx RAM address lines
-    wire   rxin;             // Rx RAM input lines
-    wire   rxwen;            // Rx RAM write enable
-    irioram32x1 irrx(rxout,rxaddr,rxin,CLK_I,wen);
+    // Receiver front end
+    reg    in_1,in_2;        // IR input in our clock domain.  ==1 if IR present
+    reg    rxlvl;            // level of the current mark or space
+    reg    [11:0] rxdur;     // duration of the current mark or space
+    reg    evt;              // ==1 for one clock at the end of a mark or space
+    reg    evlvl;            // level of the mark or space that just ended
+    reg    [11:0] evdur;     // duration of the mark or space that just ended
+    reg    gap;              // ==1 for one clock when a space reaches IRGAP
+    reg    [3:0] decen;      // decoder enables: SIRC, RC6, RC5, NEC
+    reg    rawmode;          // ==1 to send raw mark/space records
+
+    // NEC decoder
+    reg    [2:0] necst;      // wait hdr, hdr space, bit mark, bit space, repeat
+    reg    [31:0] necdata;   // received bits, first bit in the LSB
+    reg    [5:0] necn;       // number of bits received
+    reg    necvalid;         // ==1 if necdata has a frame for repeat codes
+    reg    [6:0] necms;      // ms since the last NEC frame or repeat code
+
+    // SIRC decoder
+    reg    [1:0] sirst;      // wait hdr, hdr space, bit mark, bit space
+    reg    [19:0] sirdata;   // received bits shifted in from the top
+    reg    [4:0] sirn;       // number of bits received
+    wire   sirend;           // ==1 at the end of a SIRC frame
+    wire   [19:0] siralign;  // received bits aligned to bit 0
+    wire   [1:0] sirlen;     // SIRC length code
+
+    // RC5 and RC6 decoders
+    wire   rc5done;          // ==1 when rc5data has a frame
+    wire   [20:0] rc5data;   // received bits, last bit in the LSB
+    wire   rc6done;          // ==1 when rc6data has a frame
+    wire   [20:0] rc6data;   // received bits, last bit in the LSB
+    wire   mrst;             // reset the Manchester decoders
+
+    // Receive record FIFO
+    reg    [31:0] rec;       // record to add to the FIFO
+    reg    recvalid;         // ==1 if rec is ready for the FIFO
+    reg    [3:0] wptr;       // FIFO write pointer
+    reg    [3:0] rptr;       // FIFO read pointer
+    reg    [4:0] fcount;     // number of records in the FIFO
+    wire   [31:0] fout;      // record at the read pointer
+    wire   push;             // ==1 to add rec to the FIFO
+    wire   pop;              // ==1 to remove a record from the FIFO
+    irioram16x32 irfifo(fout,rptr,rec,wptr,CLK_I,push);
+
+    // Transmitter
+    reg    [7:0] txhdr;      // protocol and flags
+    reg    [15:0] txaddr;    // address
+    reg    [7:0] txcmd;      // command
+    reg    inxmit;           // ==1 if we are transmitting an IR packet
+    reg    [2:0] txph;       // start,hdr mark,hdr space,bit half 1,half 2,trailer,quiet
+    reg    [31:0] txdata;    // bits to send, next bit in the LSB
+    reg    [5:0] txn;        // number of bits to send
+    reg    [5:0] txcnt;      // number of bits sent
+    reg    txmark;           // ==1 to send carrier
+    reg    [11:0] txtmr;     // time left in this state in units of 10 us
+    reg    [8:0] carcnt;     // carrier half period counter
+    reg    carrier;          // the carrier
+    wire   [3:0] txproto;    // protocol to send
+    wire   [8:0] carhalf;    // carrier half period in system clocks
+    wire   [7:0] revcmd;     // command bit reversed for MSB first codes
+    wire   [7:0] revaddr;    // address bit reversed for MSB first codes
+
 
     initial
     begin
-        state = 0;       // Receiver is waiting for AGC pulse
-        inone = 1;       // state 3 starts with the input high
-        in0 = 0;         // Start assuming no IR signal present
-        data_ready = 0;
-        main = 0;
+        in_1 = 0;
+        in_2 = 0;
+        rxlvl = 0;
+        rxdur = 12'hfff;
+        evt = 0;
+        gap = 0;
+        decen = 4'hf;        // all decoders on
+        rawmode = 0;
+        necst = 0;
+        necvalid = 0;
+        necms = 0;
+        sirst = 0;
+        recvalid = 0;
+        wptr = 0;
+        rptr = 0;
+        fcount = 0;
+        txhdr = 0;
+        txaddr = 0;
+        txcmd = 0;
         inxmit = 0;
+        txph = 0;
+        txmark = 0;
+        txtmr = 0;
+        carcnt = 0;
+        carrier = 0;
     end
 
+    // RC5 has no leader and an implied space as the first half of the first
+    // start bit.  RC6 has a 6T mark, 2T space leader and a double width
+    // trailer bit.  Only RC6 mode 0 frames are 21 bits long.
+    iriomanch #(.UNIT(89), .NBITS(14), .ONEMARK(0), .LEADER(0), .TRAILER(31))
+        rc5dec(CLK_I,evt,evlvl,evdur,mrst,rc5done,rc5data);
+    iriomanch #(.UNIT(44), .NBITS(21), .ONEMARK(1), .LEADER(1), .TRAILER(4))
+        rc6dec(CLK_I,evt,evlvl,evdur,mrst,rc6done,rc6data);
+
 
     always @(posedge CLK_I)
     begin
-        // Get the 200 microsecond clock
-        if (u100clk)
-            pclk <= ~pclk;
-
-        // Get the 38 KHz clock
-        if (u1clk)
+        // Get the 36/38/40 KHz carrier
+        if (carcnt >= carhalf)
         begin
-            if (c76k == 12)          // 0-12 is 13 useconds
-            begin
-                c76k <= 0;
-                c38k <= ~c38k;
-            end
-            else
-                c76k <= c76k + 4'h1;
+            carcnt <= 0;
+            carrier <= ~carrier;
         end
+        else
+            carcnt <= carcnt + 9'h001;
 
-        // Handle reads and writes from the host
-        if (TGA_I && myaddr && (ADR_I[4:0] == 31))
+        // Handle writes from the host
+        if (TGA_I && myaddr && WE_I)
         begin
-            if (~WE_I)
-                data_ready <= 0;     // Clear data ready on a read
-            else
+            if ((ADR_I[6:0] == 64) && ~inxmit)
+                txhdr <= DAT_I;
+            else if ((ADR_I[6:0] == 65) && ~inxmit)
+                txaddr[15:8] <= DAT_I;
+            else if ((ADR_I[6:0] == 66) && ~inxmit)
+                txaddr[7:0] <= DAT_I;
+            else if ((ADR_I[6:0] == 67) && ~inxmit)
+            begin
+                txcmd <= DAT_I;
+                txph <= 0;
+                txtmr <= 0;
+                txcnt <= 0;
+                inxmit <= (txproto == `IRNEC) || (txproto == `IRRC5) ||
+                          (txproto == `IRRC6) || (txproto == `IRSIRC);
+                txdata <= (txproto == `IRNEC) ? {~DAT_I, DAT_I, txaddr[15:8], txaddr[7:0]} :
+                          (txproto == `IRRC5) ? {18'h0, revcmd[7:2], revaddr[7:3], txhdr[0], ~DAT_I[6], 1'b1} :
+                          (txproto == `IRRC6) ? {11'h0, revcmd, revaddr, txhdr[0], 3'h0, 1'b1} :
+                          {12'h0, txaddr[12:0], DAT_I[6:0]};
+                txn <= (txproto == `IRNEC) ? 6'd32 :
+                       (txproto == `IRRC5) ? 6'd14 :
+                       (txproto == `IRRC6) ? 6'd21 :
+                       (txhdr[2:1] == 0) ? 6'd12 :
+                       (txhdr[2:1] == 1) ? 6'd15 : 6'd20;
+            end
+            else if (ADR_I[6:0] == 68)
             begin
-                inxmit <= 1;         // Start xmit state machine   
-                state <= 0;          // xmitter sends AGC first
-                main <= 0;
+                rawmode <= DAT_I[7];
+                decen <= DAT_I[3:0];
             end
         end
 
-        // Do xmit state machine on each edge of the 1 MHz clock
-        else if (pclk && u100clk && inxmit)
+        // Do xmit state machine on each edge of the 10 us clock
+        else if (u10clk && inxmit)
         begin
-            if (state == 0)          // Sending a 10 ms AGC pulse
+            if (txtmr != 0)
+                txtmr <= txtmr - 12'h001;
+            else if (txph == 0)          // start.  RC5 has no header
             begin
-                if (main == 50)
+                if (txproto == `IRRC5)
                 begin
-                    main <= 0;
-                    state <= 1;
+                    txph <= 3;
+                    txmark <= h1mark(txproto, txdata[0]);
+                    txtmr <= h1dur(txproto, txdata[0], 1'b0);
                 end
                 else
-                    main <= main + 6'h01;
-            end
-            if (state == 1)          // Sending 4.4 ms pause after AGC
-            begin
-                if (main == 22)
                 begin
-                    main <= 0;
-                    state <= 2;      // Go to 'sending bits' state
-                    count <= 0;      // Start on bit #0
-                    inone <= 1;      // start bit by sending IR pulse
-                    c38k <= 0;
+                    txph <= 1;
+                    txmark <= 1;
+                    txtmr <= (txproto == `IRNEC) ? 12'd900 :
+                             (txproto == `IRSIRC) ? 12'd240 : 12'd266;
                 end
-                else
-                    main <= main + 6'h01;
             end
-            if (state == 2)          // Sending data bits
+            else if (txph == 1)          // header space
+            begin
+                txph <= 2;
+                txmark <= 0;
+                txtmr <= ((txproto == `IRNEC) && txhdr[0]) ? 12'd225 :
+                         (txproto == `IRNEC) ? 12'd450 :
+                         (txproto == `IRSIRC) ? 12'd60 : 12'd89;
+            end
+            else if (txph == 2)          // first bit, or trailer of NEC repeat code
             begin
-                if (inone)
+                if ((txproto == `IRNEC) && txhdr[0])
                 begin
-                    if (main == 2)   // End of 600 us IR pulse?
-                    begin
-                        main <= 0;
-                        inone <= 0;
-                    end
-                    else
-                        main <= main + 6'h01;
+                    txph <= 5;
+                    txmark <= 1;
+                    txtmr <= 12'd56;
                 end
-                else  // must be in pause after bit's IR pulse
+                else
                 begin
-                    if (((rxout == 0) && (main != 2)) ||
-                        ((rxout == 1) && (main != 7)))
-                    begin
-                        main <= main + 6'h01;
-                    end
-                    else  // done with this bit
-                    begin
-                        if (count == 31)
-                        begin
-                            state <= 3;
-                        end
-                        else  // go to start of next bit
-                        begin
-                            count <= count + 6'h01;
-                        end
-                        inone <= 1;
-                        c38k <= 0;
-                        main <= 0;
-                    end
+                    txph <= 3;
+                    txmark <= h1mark(txproto, txdata[0]);
+                    txtmr <= h1dur(txproto, txdata[0], (txcnt == 4));
                 end
             end
-            if (state == 3)          // Sending trailing pulse to define last bit
+            else if (txph == 3)          // second half of bit
             begin
-                if (main == 2)       // Trailing pulse is 600 us
+                txph <= 4;
+                txmark <= h2mark(txproto, txdata[0]);
+                txtmr <= h2dur(txproto, txdata[0], (txcnt == 4));
+            end
+            else if (txph == 4)          // next bit or trailer
+            begin
+                txcnt <= txcnt + 6'h01;
+                txdata <= {1'b0, txdata[31:1]};
+                if ((txcnt + 6'h01) == txn)
                 begin
-                    main <= 0;
-                    inxmit <= 0;
-                    state <= 0;      // Let receiver listen for AGC pulse
+                    txph <= 5;
+                    txmark <= (txproto == `IRNEC);  // NEC ends with a stop mark
+                    txtmr <= (txproto == `IRNEC) ? 12'd56 : 12'd0;
                 end
                 else
-                    main <= main + 6'h01;
+                begin
+                    txph <= 3;
+                    txmark <= h1mark(txproto, txdata[1]);
+                    txtmr <= h1dur(txproto, txdata[1], ((txcnt + 6'h01) == 4));
+                end
+            end
+            else if (txph == 5)          // quiet time after the frame
+            begin
+                txph <= 6;
+                txmark <= 0;
+                txtmr <= 12'd1000;
+            end
+            else
+            begin
+                inxmit <= 0;
+                txph <= 0;
             end
         end
 
-        // Do all receiver processing on edge of 200 us clock
-        else if (pclk && u100clk && ~data_ready && ~inxmit)
+        // Receiver front end.  Give the decoders the level and duration
+        // of each mark and space.  Ignore the receiver while transmitting.
+        in_1 <= ~irin;
+        in_2 <= in_1;
+        evt <= 0;
+        gap <= 0;
+        if (inxmit)
         begin
-            // Get the input into our clock domain
-            // in0 == 1 when IR signal is present.
-            in0 <= ~irin;
+            rxlvl <= 0;
+            rxdur <= 12'hfff;
+        end
+        else if (u10clk)
+        begin
+            if (in_2 != rxlvl)
+            begin
+                evt <= 1;
+                evlvl <= rxlvl;
+                evdur <= rxdur;
+                rxlvl <= in_2;
+                rxdur <= 12'h001;
+            end
+            else
+            begin
+                if (rxdur != 12'hfff)
+                    rxdur <= rxdur + 12'h001;
+                if (~rxlvl && (rxdur == `IRGAP))
+                    gap <= 1;
+            end
+        end
 
-            // Process the state machine
-            if (state == 0)          // waiting for AGC
+        // NEC decoder.  Repeat codes are only valid for a short time
+        // after the last frame or repeat code.
+        if (m1clk && (necms != `IRNECRPT))
+            necms <= necms + 7'h01;
+        if (inxmit || rawmode || (necms == `IRNECRPT))
+            necvalid <= 0;
+        if (gap || inxmit)
+            necst <= 0;
+        else if (evt)
+        begin
+            if (necst == 0)              // waiting for 9 ms header mark
             begin
-                main <= (in0) ? (main + 6'h01) : 6'h00;
-                if (main == 40)      // 8 milliseconds ?
-                    state <= 1;      // go to "in AGC"
+                if (evlvl && near(evdur, 12'd900))
+                    necst <= 1;
             end
-            else if (state == 1)     // in AGC pulse, wait for its end
+            else if (necst == 1)         // 4.5 ms header space or 2.25 ms repeat space
             begin
-                if (in0 == 0)
+                if (~evlvl && near(evdur, 12'd450))
                 begin
-                    state <= 2;      // go to "in pause"
-                    main <= 0;
+                    necst <= 2;
+                    necn <= 0;
+                    necvalid <= 0;
                 end
+                else if (~evlvl && near(evdur, 12'd225))
+                    necst <= 4;
+                else
+                    necst <= 0;
             end
-            else if (state == 2)     // in pause
+            else if (necst == 2)         // 562 us mark before each bit and at the end
             begin
-                if (in0 == 0)
+                if (evlvl && near(evdur, 12'd56))
                 begin
-                    main <= main + 6'h01;
-                    if (main == 6'h3f)   // error if main wraps while in pause period
-                        state <= 0;  // Back to waiting for AGC pulse
-                end
-                else
-                begin                // getting an IR signal, go get data bits
-                    if (main > 9)    // pause period is at least 1.8 milliseconds
+                    if (necn == 32)
                     begin
-                        state <= 3;  // Go get data bits
-                        inone <= 1;
-                        count <= 0;
+                        necst <= 0;
+                        necvalid <= ~rawmode && (necdata[31:24] == ~necdata[23:16]);
+                        necms <= 0;
                     end
-                    else             // pause less than 2 ms is an error
-                    begin
-                        state <= 0;  // Back to waiting for AGC pulse
-                    end
-                    main <= 0; 
+                    else
+                        necst <= 3;
                 end
+                else
+                    necst <= 0;
             end
-            else if (state == 3)     // collecting data bits
+            else if (necst == 3)         // space is 562 us for a zero, 1.69 ms for a one
             begin
-                if (inone == 0)      // data is in the low period.  Measure this time
+                if (~evlvl && (near(evdur, 12'd56) || near(evdur, 12'd169)))
                 begin
-                    if (in0 == 0)
-                    begin
-                        main <= main + 6'h01;
-                        if (main > 20)
-                        begin
-                            data_ready <= 1;
-                            state <= 0;
-                            main <= 0;
-                        end
-                    end
-                    else             // Got the edge of the next bit.  Record this bit
-                    begin
-                        // The value of main is stored in the shift register at this time
-                        main <= 0;
-                        inone <= 1;
-                        count <= count + 6'h01;
-                        if (count == 5'h1f)   // Force packet end on bit 31
-                        begin
-                            data_ready <= 1;
-                            state <= 0;
-                            main <= 0;
-                        end
-                    end
+                    necdata <= {near(evdur, 12'd169), necdata[31:1]};
+                    necn <= necn + 6'h01;
+                    necst <= 2;
                 end
-                else     // inone==1
+                else
+                    necst <= 0;
+            end
+            else                         // trailing mark of a repeat code
+                necst <= 0;
+        end
+
+        // SIRC decoder
+        if (gap || inxmit || sirend)
+            sirst <= 0;
+        else if (evt)
+        begin
+            if (sirst == 0)              // waiting for 2.4 ms header mark
+            begin
+                if (evlvl && near(evdur, 12'd240))
+                    sirst <= 1;
+            end
+            else if (sirst == 1)         // 600 us header space
+            begin
+                if (~evlvl && near(evdur, 12'd60))
                 begin
-                    if (in0 == 0)
-                    begin
-                        // At the end of the IR pulse.  Was it the right width?
-                        if (main > 5)
-                        begin
-                            main <= 0;
-                            state <= 0;
-                        end
-                        else         // switch to inone==false and measure time
-                        begin
-                            inone <= 0;
-                            main <= 0;
-                        end
-                    end
-                    else             // input==1 so state in the 'inone==true' state
-                    begin
-                        main <= main + 6'h01;
-                    end
+                    sirst <= 2;
+                    sirn <= 0;
+                    sirdata <= 0;
                 end
+                else
+                    sirst <= 0;
+            end
+            else if (sirst == 2)         // mark is 600 us for a zero, 1.2 ms for a one
+            begin
+                if (evlvl && (near(evdur, 12'd60) || near(evdur, 12'd120)) && (sirn != 20))
+                begin
+                    sirdata <= {near(evdur, 12'd120), sirdata[19:1]};
+                    sirn <= sirn + 5'h01;
+                    sirst <= 3;
+                end
+                else
+                    sirst <= 0;
             end
+            else                         // 600 us space between bits
+                sirst <= 2;
         end
+
+        // Build a record from the decoders or from the raw timing
+        recvalid <= 0;
+        if (rawmode)
+        begin
+            if (evt)
+            begin
+                rec <= {`IRRAW, evlvl, 3'h0, 4'h0, evdur, 8'h00};
+                recvalid <= 1;
+            end
+        end
+        else if (evt && decen[0] && (necst == 2) && evlvl && near(evdur, 12'd56) &&
+                 (necn == 32) && (necdata[31:24] == ~necdata[23:16]))
+        begin
+            rec <= {`IRNEC, 4'h0, necdata[15:0], necdata[23:16]};
+            recvalid <= 1;
+        end
+        else if (evt && decen[0] && (necst == 4) && evlvl && near(evdur, 12'd56) && necvalid)
+        begin
+            rec <= {`IRNEC, 4'h1, necdata[15:0], necdata[23:16]};
+            recvalid <= 1;
+            necms <= 0;
+        end
+        else if (rc5done && decen[1])
+        begin
+            rec <= {`IRRC5, 3'h0, rc5data[11], 11'h000, rc5data[10:6], 1'b0, ~rc5data[12], rc5data[5:0]};
+            recvalid <= 1;
+        end
+        else if (rc6done && decen[2] && rc6data[20] && (rc6data[19:17] == 0))
+        begin
+            rec <= {`IRRC6, 3'h0, rc6data[16], 8'h00, rc6data[15:8], rc6data[7:0]};
+            recvalid <= 1;
+        end
+        else if (sirend && decen[3] && ((sirn == 12) || (sirn == 15) || (sirn == 20)))
+        begin
+            rec <= {`IRSIRC, 1'b0, sirlen, 1'b0, 3'h0, siralign[19:7], 1'b0, siralign[6:0]};
+            recvalid <= 1;
+        end
+
+        // Update the FIFO pointers
+        if (push)
+            wptr <= wptr + 4'h1;
+        if (pop)
+            rptr <= rptr + 4'h1;
+        if (push & ~pop)
+            fcount <= fcount + 5'h01;
+        else if (pop & ~push)
+            fcount <= fcount - 5'h01;
     end
 
 
-    // Route the RAM and output lines
-    assign rxaddr = (TGA_I & myaddr) ? ADR_I[4:0] : count[4:0] ;
-    // data into the RAM is the data bus on host write or the IR signal on receive pkts
-    assign rxin = (TGA_I & myaddr & WE_I & ~(ADR_I[5:0] == 32)) ? DAT_I[0] :
-                  (main > 4) ? 1'b1 : 1'b0;   // decide if bit is a zero or a one
-    // latch data while receiving IR or when getting a packet from the host
-    assign wen  = ((state == 3) && (inone == 0) && (in0 == 1))  // start of next IR bit
-                  | (TGA_I & myaddr & WE_I & ~(ADR_I[5:0] == 32)); // latch host write
+    // Return true if a duration is within 25 percent of nominal
+    function near;
+        input [11:0] dur;
+        input [11:0] nom;
+        begin
+            near = (dur > (nom - (nom >> 2))) && (dur < (nom + (nom >> 2)));
+        end
+    endfunction
+
+    // Level and duration of the first half of a bit.  The second half is a
+    // space for NEC and SIRC and the opposite of the first half for RC5/RC6.
+    // RC6 uses a double width trailer bit.
+    function h1mark;
+        input [3:0] proto;
+        input b;
+        begin
+            h1mark = (proto == `IRRC5) ? ~b :
+                     (proto == `IRRC6) ? b : 1'b1;
+        end
+    endfunction
+
+    function [11:0] h1dur;
+        input [3:0] proto;
+        input b;
+        input trailer;
+        begin
+            h1dur = (proto == `IRNEC) ? 12'd56 :
+                    (proto == `IRSIRC) ? ((b) ? 12'd120 : 12'd60) :
+                    (proto == `IRRC5) ? 12'd89 :
+                    (trailer) ? 12'd89 : 12'd44;
+        end
+    endfunction
+
+    function h2mark;
+        input [3:0] proto;
+        input b;
+        begin
+            h2mark = (proto == `IRRC5) ? b :
+                     (proto == `IRRC6) ? ~b : 1'b0;
+        end
+    endfunction
+
+    function [11:0] h2dur;
+        input [3:0] proto;
+        input b;
+        input trailer;
+        begin
+            h2dur = (proto == `IRNEC) ? ((b) ? 12'd169 : 12'd56) :
+                    (proto == `IRSIRC) ? 12'd60 :
+                    (proto == `IRRC5) ? 12'd89 :
+                    (trailer) ? 12'd89 : 12'd44;
+        end
+    endfunction
+
+
+    // SIRC frames end with a long space after the last bit mark
+    assign sirend = (sirst == 3) && ~inxmit &&
+                    (gap || (evt && ~evlvl && ~near(evdur, 12'd60)));
+    assign siralign = sirdata >> (5'd20 - sirn);
+    assign sirlen = (sirn == 12) ? 2'h0 : (sirn == 15) ? 2'h1 : 2'h2;
+    assign mrst = gap | inxmit | rawmode;
+
+    // Transmit lines
+    assign txproto = txhdr[7:4];
+    assign carhalf = (txproto == `IRNEC) ? 9'd263 :     // 38 KHz at 20 MHz
+                     (txproto == `IRSIRC) ? 9'd250 :    // 40 KHz
+                     9'd278;                            // 36 KHz
+    assign revcmd = {DAT_I[0],DAT_I[1],DAT_I[2],DAT_I[3],DAT_I[4],DAT_I[5],DAT_I[6],DAT_I[7]};
+    assign revaddr = {txaddr[0],txaddr[1],txaddr[2],txaddr[3],
+                      txaddr[4],txaddr[5],txaddr[6],txaddr[7]};
+
+    // FIFO lines.  Reading the last byte of a record removes it.
+    assign push = recvalid && (fcount != 16);
+    assign pop = TGA_I && myaddr && ~WE_I && (ADR_I[6] == 0) && (ADR_I[1:0] == 3) &&
+                 (fcount != 0);
 
     // Assign the outputs.
-    assign myaddr = (STB_I) && (ADR_I[7:5] == 0);
+    assign myaddr = (STB_I) && (ADR_I[7] == 0);
     assign DAT_O = (~myaddr) ? DAT_I :
-                    (~TGA_I && myaddr && data_ready) ? 8'h20 :  // Send 32 bytes if ready
-                    (TGA_I) ? {7'h0,rxout} : 
+                    (~TGA_I && (fcount != 0)) ? {1'b0, fcount, 2'b00} :  // 4 bytes per record
+                    (~TGA_I) ? 8'h00 :
+                    ((ADR_I[6] == 0) && (fcount == 0)) ? 8'h00 :
+                    ((ADR_I[6] == 0) && (ADR_I[1:0] == 0)) ? fout[31:24] :
+                    ((ADR_I[6] == 0) && (ADR_I[1:0] == 1)) ? fout[23:16] :
+                    ((ADR_I[6] == 0) && (ADR_I[1:0] == 2)) ? fout[15:8] :
+                    (ADR_I[6] == 0) ? fout[7:0] :
+                    (ADR_I[5:0] == 0) ? txhdr :
+                    (ADR_I[5:0] == 1) ? txaddr[15:8] :
+                    (ADR_I[5:0] == 2) ? txaddr[7:0] :
+                    (ADR_I[5:0] == 3) ? txcmd :
+                    (ADR_I[5:0] == 4) ? {rawmode, 3'h0, decen} :
+                    (ADR_I[5:0] == 5) ? {inxmit, 2'h0, fcount} :
                     8'h00 ; 
 
     // Loop in-to-out where appropriate
     assign STALL_O = 0;
     assign ACK_O = myaddr;
 
-    assign rxled = ~(((state != 0) && ~inxmit) || data_ready);
+    assign rxled = ~((rxlvl & ~inxmit) | (fcount != 0));
     assign txled = ~inxmit;
-    assign irout = ~(inxmit & c38k & inone & (state != 1));
+    assign irout = ~(inxmit & txmark & carrier);
+
+endmodule
+
+
+//  Manchester decoder for RC5 and RC6.  Each mark or space is one, two,
+//  or three half bit slots long.  The position of each event is kept in
+//  slots from the start of the first bit.  The value of a bit is taken
+//  from the level of the event that covers the first half of the bit.
+//  The trailer bit, if any, is twice as wide as the others.  Without a
+//  leader a frame can only start after the line has been idle.
+module iriomanch(CLK_I,evt,evlvl,evdur,rst,done,data);
+    parameter UNIT = 89;     // half bit time in units of 10 us
+    parameter NBITS = 14;    // number of bits in a frame
+    parameter ONEMARK = 0;   // ==1 if a one starts with a mark
+    parameter LEADER = 0;    // ==1 if a 6 unit mark and 2 unit space start the frame
+    parameter TRAILER = 31;  // index of the double width trailer bit
+    input    CLK_I;          // system clock
+    input    evt;            // ==1 at the end of a mark or space
+    input    evlvl;          // ==1 if it was a mark
+    input    [11:0] evdur;   // its duration in units of 10 us
+    input    rst;            // ==1 to abort any frame in progress
+    output   done;           // ==1 for one clock when data has a frame
+    output   [20:0] data;    // received bits, last bit in the LSB
+
+    reg      [1:0] st;       // idle, in leader, in bits, wait for end of frame
+    reg      [5:0] tpos;     // slot at the start of the next event
+    reg      [4:0] nb;       // index of the next bit
+    reg      [20:0] shft;    // received bits
+    reg      dreg;           // done
+    reg      armed;          // ==1 if the line has been idle since the last frame
+    wire     [1:0] k;        // length of the event in slots, 0 on error
+    wire     [5:0] ctpos;    // slot, bit, and bits at the start of this event
+    wire     [4:0] cnb;
+    wire     [20:0] cshft;
+    wire     [5:0] fs;       // slot of the first half of the next bit
+
+    initial
+    begin
+        st = 0;
+        dreg = 0;
+        armed = 1;
+    end
+
+    always @(posedge CLK_I)
+    begin
+        dreg <= 0;
+        if (rst)
+        begin
+            st <= 0;
+            armed <= 1;
+        end
+        else if (evt)
+        begin
+            if (evlvl)
+                armed <= 0;
+            if ((st == 0) && (LEADER == 1))
+            begin
+                if (evlvl && (evdur > (UNIT * 5)) && (evdur < (UNIT * 7)))
+                    st <= 1;
+            end
+            else if (st == 1)
+            begin
+                if (~evlvl && (k == 2))
+                begin
+                    st <= 2;
+                    tpos <= 0;
+                    nb <= 0;
+                    shft <= 0;
+                end
+                else
+                    st <= 0;
+            end
+            else if (((st == 0) && evlvl && armed) || (st == 2))
+            begin
+                // An event that starts on a first half may only cover that
+                // half, or both slots of the first half of the trailer bit.
+                if ((k == 0) || (fs < ctpos) || ((TRAILER == 31) && (k == 3)) ||
+                    ((ctpos == fs) && (k != 1) && ~((cnb == TRAILER) && (k == 2))))
+                    st <= 0;         // not a valid Manchester code
+                else
+                begin
+                    st <= 2;
+                    tpos <= ctpos + k;
+                    nb <= cnb;
+                    shft <= cshft;
+                    if (fs < (ctpos + k))
+                    begin
+                        shft <= {cshft[19:0], (evlvl == ONEMARK)};
+                        nb <= cnb + 5'h01;
+                        if ((cnb + 5'h01) == NBITS)
+                        begin
+                            dreg <= 1;
+                            st <= 3;
+                        end
+                    end
+                end
+            end
+        end
+    end
+
+    // Without a leader the first half of the first bit is the idle space.
+    assign ctpos = (st == 0) ? 6'h01 : tpos;
+    assign cnb   = (st == 0) ? 5'h01 : nb;
+    assign cshft = (st == 0) ? 21'h000001 : shft;
+    assign fs = (cnb > TRAILER) ? ({cnb, 1'b0} + 6'h02) : {cnb, 1'b0};
+    assign k = ((evdur > (UNIT / 2)) && (evdur < ((UNIT * 3) / 2))) ? 2'h1 :
+               ((evdur >= ((UNIT * 3) / 2)) && (evdur < ((UNIT * 5) / 2))) ? 2'h2 :
+               ((evdur >= ((UNIT * 5) / 2)) && (evdur < ((UNIT * 7) / 2))) ? 2'h3 :
+               2'h0;
+
+    assign done = dreg;
+    assign data = shft;
 
 endmodule
 
 
-module irioram32x1(dout,addr,din,wclk,wen);
-    output   dout;
-    input    [4:0] addr;
-    input    din;
+//  Record FIFO with separate read and write addresses
+module irioram16x32(dout,raddr,din,waddr,wclk,wen);
+    output   [31:0] dout;
+    input    [3:0] raddr;
+    input    [31:0] din;
+    input    [3:0] waddr;
     input    wclk;
     input    wen;
 
-    reg      ram [31:0];
+    reg      [31:0] ram [15:0];
 
     always@(posedge wclk)
     begin
         if (wen)
-            ram[addr] <= din;
+            ram[waddr] <= din;
     end
 
-    assign dout = ram[addr];
+    assign dout = ram[raddr];
 
 endmodule
-
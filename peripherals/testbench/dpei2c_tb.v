@@ -0,0 +1,340 @@
+// *********************************************************
+// Copyright (c) 2022 Demand Peripherals, Inc.
+//
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+//
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+//
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+//
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+/////////////////////////////////////////////////////////////////////////
+// dpei2c_tb.v : Testbench for the queued I2C master
+//
+//  Registers are
+//    Addr=0-127  Results of the last run
+//    Addr=128    Control.  Clock select and run bit
+//    Addr=130    Command queue address
+//    Addr=131    Command queue data
+//    Addr=132    Status.  Bit 7 busy, bit 6 results pending
+//
+//  The testbench models the ei2c card: two D flip-flops that drive
+//  open-drain SDA and SCL, and the NAND gates that put SDA or SCL on
+//  pin8.  An I2C slave at address 0x50 has sixteen bytes of memory.
+//  The first byte written after the address sets the memory pointer.
+//  The slave stretches SCL for 20 us after ACKing the pointer.
+//
+//  The test procedure is as follows:
+//  - Load a queue that writes a pointer of 2 to the slave and reads
+//    three bytes after a repeated start, then writes to a missing
+//    slave at 0x58 and tries to read two bytes from it, then reads
+//    one more byte from the slave at 0x50
+//  - Run the queue at 400 KHz and wait for the results
+//  - Verify the poll length and the results: the sequence number,
+//    one NACK, the three bytes, 0xff 0xff for the skipped read, and
+//    the last byte
+//  - Run the queue again at 1 MHz and verify the sequence number
+//    increments and the results are the same
+
+`timescale 1ns/1ns
+
+
+module dpei2c_tb;
+    reg    CLK_I;            // system clock
+    reg    WE_I;             // direction of this transfer. Read=0; Write=1
+    reg    TGA_I;            // ==1 if reg access, ==0 if poll
+    reg    STB_I;            // ==1 if this peri is being addressed
+    reg    [7:0] ADR_I;      // address of target register
+    wire   STALL_O;          // ==1 if we need more clk cycles to complete
+    wire   ACK_O;            // ==1 if we claim the above address
+    reg    [7:0] DAT_I;      // Data INto the peripheral;
+    wire   [7:0] DAT_O;      // Data OUTput from the peripheral, = DAT_I if not us.
+    reg    [`MXCLK:0] clocks; // Array of clock pulses from 10ns to 1 second
+    wire   [3:0] pins;       // D, SDA clock, SCL clock, and SDA/SCL input
+    reg    [7:0] got;        // last register read
+    integer errors;          // number of failed checks
+    integer i;               // loop index
+
+    // The ei2c card
+    reg    qsda;             // SDA flip-flop.  ==1 to pull SDA low
+    reg    qscl;             // SCL flip-flop.  ==1 to pull SCL low
+    wire   sda;              // the I2C data line
+    wire   scl;              // the I2C clock line
+
+    // The I2C slave
+    reg    [7:0] smem [0:15]; // slave memory
+    reg    [1:0] sst;        // idle, address, write data, read data
+    reg    [3:0] scnt;       // bits done in this byte, 8 is the ACK
+    reg    [7:0] sshift;     // byte being sent or received
+    reg    sfirst;           // ==1 if the next write byte is the pointer
+    reg    [3:0] sptr;       // memory pointer
+    reg    sdalow;           // ==1 when the slave pulls SDA low
+    integer stretch;         // system clocks left to hold SCL low
+
+
+    // Add the device under test
+    dpei2c dpei2c_dut(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins);
+
+    always @(posedge pins[1]) qsda <= pins[0];
+    always @(posedge pins[2]) qscl <= pins[0];
+    assign sda = ~qsda & ~sdalow;
+    assign scl = ~qscl & (stretch == 0);
+    assign pins[3] = ~((pins[0] & sda) | (pins[2] & scl));
+
+    // generate the clock(s)
+    initial  CLK_I = 1;
+    always   #25 CLK_I = ~CLK_I;
+    initial  clocks = 0;
+    always   begin #50 clocks[`N100CLK] = 1;  #50 clocks[`N100CLK] = 0; end
+    always   begin #950 clocks[`U1CLK] = 1;  #50 clocks[`U1CLK] = 0; end
+    always   begin #9950 clocks[`U10CLK] = 1;  #50 clocks[`U10CLK] = 0; end
+    always   begin #99950 clocks[`U100CLK] = 1;  #50 clocks[`U100CLK] = 0; end
+    always   begin #999950 clocks[`M1CLK] = 1;  #50 clocks[`M1CLK] = 0; end
+
+
+    // I2C slave.  Start and stop are SDA changes while SCL is high.
+    always @(negedge sda)
+        if (scl)
+        begin
+            sst = 1;
+            scnt = 15;           // the SCL fall that ends the start makes this 0
+            sdalow = 0;
+        end
+
+    always @(posedge sda)
+        if (scl)
+        begin
+            sst = 0;
+            sdalow = 0;
+        end
+
+    // Sample SDA on the rising edge of SCL.  A NACK ends a read.
+    always @(posedge scl)
+    begin
+        if (((sst == 1) || (sst == 2)) && (scnt < 8))
+            sshift = {sshift[6:0], sda};
+        else if ((sst == 3) && (scnt == 8) && sda)
+            sst = 0;
+    end
+
+    // Drive SDA on the falling edge of SCL
+    always @(negedge scl)
+    begin
+        if (sst != 0)
+        begin
+            scnt = scnt + 1;
+            sdalow = 0;
+            if (scnt == 8)               // ACK the address or a write byte
+            begin
+                if ((sst == 1) && (sshift[7:1] == 7'h50))
+                    sdalow = 1;
+                else if (sst == 1)
+                    sst = 0;
+                else if (sst == 2)
+                begin
+                    sdalow = 1;
+                    if (sfirst)
+                    begin
+                        sptr = sshift[3:0];
+                        sfirst = 0;
+                        stretch = 400;
+                    end
+                    else
+                    begin
+                        smem[sptr] = sshift;
+                        sptr = sptr + 1;
+                    end
+                end
+            end
+            else if (scnt == 9)          // ACK done, start the next byte
+            begin
+                scnt = 0;
+                if (sst == 1)
+                begin
+                    sst = (sshift[0]) ? 3 : 2;
+                    sfirst = 1;
+                end
+                if (sst == 3)
+                begin
+                    sshift = smem[sptr];
+                    sptr = sptr + 1;
+                    sdalow = ~sshift[7];
+                end
+            end
+            else if (sst == 3)
+                sdalow = ~sshift[7 - scnt];
+        end
+    end
+
+    always @(posedge CLK_I)
+        if (stretch != 0)
+            stretch <= stretch - 1;
+
+
+    // Write a register
+    task wrreg;
+        input [7:0] addr;
+        input [7:0] data;
+        begin
+            @(negedge CLK_I)
+            WE_I = 1; TGA_I = 1; STB_I = 1; ADR_I = addr; DAT_I = data;
+            @(negedge CLK_I)
+            WE_I = 0; TGA_I = 0; STB_I = 0; ADR_I = 0; DAT_I = 0;
+        end
+    endtask
+
+    // Read a register.  Result reads stall for one clock.
+    task rdreg;
+        input [7:0] addr;
+        begin
+            @(negedge CLK_I)
+            WE_I = 0; TGA_I = 1; STB_I = 1; ADR_I = addr; DAT_I = 0;
+            @(posedge CLK_I)
+            while (STALL_O)
+                @(posedge CLK_I);
+            got = DAT_O;
+            @(negedge CLK_I)
+            WE_I = 0; TGA_I = 0; STB_I = 0; ADR_I = 0; DAT_I = 0;
+        end
+    endtask
+
+    // Poll the peripheral the way busif does
+    task poll;
+        begin
+            @(negedge CLK_I)
+            WE_I = 1; TGA_I = 0; STB_I = 1; ADR_I = 0; DAT_I = 0;
+            @(posedge CLK_I)
+            got = DAT_O;
+            @(negedge CLK_I)
+            WE_I = 0; TGA_I = 0; STB_I = 0; ADR_I = 0; DAT_I = 0;
+        end
+    endtask
+
+    task check;
+        input [7:0] value;
+        input [7:0] want;
+        begin
+            if (value != want)
+            begin
+                $display("FAIL: got %h, expected %h", value, want);
+                errors = errors + 1;
+            end
+            else
+                $display("PASS: %h", value);
+        end
+    endtask
+
+    // Load one byte into the command queue
+    task qbyte;
+        input [7:0] data;
+        begin
+            wrreg(131, data);
+        end
+    endtask
+
+    // Run the queue and verify the results
+    task runq;
+        input [1:0] clksel;
+        input [7:0] seq;
+        begin
+            wrreg(128, {3'h0, 1'b1, 2'h0, clksel});
+            got = 0;
+            while (got[6] == 0)
+                rdreg(132);
+            poll;
+            check(got, 8);
+            rdreg(0);
+            check(got, seq);
+            rdreg(1);
+            check(got, 8'h01);           // one NACK, no timeout
+            rdreg(2);
+            check(got, 8'h12);
+            rdreg(3);
+            check(got, 8'h13);
+            rdreg(4);
+            check(got, 8'h14);
+            rdreg(5);
+            check(got, 8'hff);
+            rdreg(6);
+            check(got, 8'hff);
+            rdreg(7);
+            check(got, 8'h15);
+            rdreg(132);
+            check(got, 8'h00);           // idle, nothing pending
+        end
+    endtask
+
+
+    // Test the device
+    initial
+    begin
+        $display($time);
+        $dumpfile ("dpei2c_tb.xt2");
+        $dumpvars (0, dpei2c_tb);
+        //  - Set bus lines and FPGA pins to default state
+        WE_I = 0; TGA_I = 0; STB_I = 0; ADR_I = 0; DAT_I = 0;
+        qsda = 0; qscl = 0;
+        sst = 0; scnt = 0; sdalow = 0; sfirst = 0; sptr = 0;
+        stretch = 0;
+        errors = 0;
+        for (i = 0; i < 16; i = i + 1)
+            smem[i] = 8'h10 + i;
+
+        #1000    // some time later
+
+        //  - Load the command queue
+        wrreg(130, 0);
+        qbyte(8'h01);                    // start
+        qbyte(8'h41);                    // write 2
+        qbyte(8'ha0);                    //   slave 0x50, write
+        qbyte(8'h02);                    //   pointer
+        qbyte(8'h01);                    // repeated start
+        qbyte(8'h40);                    // write 1
+        qbyte(8'ha1);                    //   slave 0x50, read
+        qbyte(8'h82);                    // read 3
+        qbyte(8'h02);                    // stop
+        qbyte(8'h01);                    // start
+        qbyte(8'h41);                    // write 2
+        qbyte(8'hb0);                    //   missing slave 0x58, write
+        qbyte(8'h00);                    //   pointer, skipped
+        qbyte(8'h81);                    // read 2, skipped
+        qbyte(8'h02);                    // stop
+        qbyte(8'h01);                    // start
+        qbyte(8'h40);                    // write 1
+        qbyte(8'ha1);                    //   slave 0x50, read
+        qbyte(8'h80);                    // read 1
+        qbyte(8'h02);                    // stop
+        qbyte(8'h00);                    // end
+
+        //  - Run at 400 KHz then at 1 MHz
+        runq(2, 0);
+        runq(3, 1);
+
+        if (errors == 0)
+            $display("dpei2c_tb: all tests passed");
+        else
+            $display("dpei2c_tb: %0d errors", errors);
+
+        $finish;
+    end
+endmodule
+
@@ -0,0 +1,317 @@
+// *********************************************************
+// Copyright (c) 2022 Demand Peripherals, Inc.
+//
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+//
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+//
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+//
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+/////////////////////////////////////////////////////////////////////////
+// irio_tb.v : Testbench for the irio protocol decoders
+//
+//  Registers are
+//    Addr=0-63   Receive FIFO of four byte records
+//    Addr=69     Status.  Bits 0-4 are the number of records
+//
+//  The test procedure is as follows:
+//  - Send a NEC frame, a NEC repeat code 40 ms later, and a NEC
+//    repeat code 130 ms after that which must be ignored
+//  - Send an RC5 frame, and an RC5 frame with a bad bit which must
+//    be ignored
+//  - Send an RC6 mode 0 frame
+//  - Send SIRC frames of 12, 15, and 20 bits
+//  - After each frame verify that exactly one record is in the FIFO
+//    and that the record matches the frame
+//
+//  The receiver input is active low.  A mark (IR present) is a zero
+//  on the pin.
+
+`timescale 1ns/1ns
+
+
+module irio_tb;
+    reg    CLK_I;            // system clock
+    reg    WE_I;             // direction of this transfer. Read=0; Write=1
+    reg    TGA_I;            // ==1 if reg access, ==0 if poll
+    reg    STB_I;            // ==1 if this peri is being addressed
+    reg    [7:0] ADR_I;      // address of target register
+    wire   STALL_O;          // ==1 if we need more clk cycles to complete
+    wire   ACK_O;            // ==1 if we claim the above address
+    reg    [7:0] DAT_I;      // Data INto the peripheral;
+    wire   [7:0] DAT_O;      // Data OUTput from the peripheral, = DAT_I if not us.
+    reg    [`MXCLK:0] clocks; // Array of clock pulses from 10ns to 1 second
+    wire   [3:0] pins;       // LEDs, IR output, and IR receiver input
+    reg    irin;             // IR receiver output.  Low when IR is present
+    reg    [31:0] got;       // record read from the FIFO
+    reg    [7:0] status;     // status register
+    integer errors;          // number of failed checks
+    integer i;               // bit index
+
+
+    // Add the device under test
+    irio irio_dut(CLK_I,WE_I,TGA_I,STB_I,ADR_I,STALL_O,ACK_O,DAT_I,DAT_O,clocks,pins);
+
+    assign pins[3] = irin;
+
+    // generate the clock(s)
+    initial  CLK_I = 1;
+    always   #25 CLK_I = ~CLK_I;
+    initial  clocks = 0;
+    always   begin #50 clocks[`N100CLK] = 1;  #50 clocks[`N100CLK] = 0; end
+    always   begin #950 clocks[`U1CLK] = 1;  #50 clocks[`U1CLK] = 0; end
+    always   begin #9950 clocks[`U10CLK] = 1;  #50 clocks[`U10CLK] = 0; end
+    always   begin #99950 clocks[`U100CLK] = 1;  #50 clocks[`U100CLK] = 0; end
+    always   begin #999950 clocks[`M1CLK] = 1;  #50 clocks[`M1CLK] = 0; end
+
+
+    // Send IR (mark) or no IR (space) for a number of microseconds
+    task mark;
+        input [31:0] us;
+        begin
+            irin = 0;
+            #(us * 1000);
+        end
+    endtask
+
+    task space;
+        input [31:0] us;
+        begin
+            irin = 1;
+            #(us * 1000);
+        end
+    endtask
+
+    // One half bit of a Manchester code.  RC5 halves are 889 us and RC6
+    // halves are 444 us.
+    task half;
+        input lvl;
+        input [31:0] us;
+        begin
+            irin = ~lvl;
+            #(us * 1000);
+        end
+    endtask
+
+    // NEC frame of four bytes sent LSB first, or a repeat code
+    task nec;
+        input [31:0] data;   // first byte to send in bits 7-0
+        begin
+            mark(9000);
+            space(4500);
+            for (i = 0; i < 32; i = i + 1)
+            begin
+                mark(562);
+                space((data[i]) ? 1687 : 562);
+            end
+            mark(562);
+            space(10000);
+        end
+    endtask
+
+    task necrpt;
+        begin
+            mark(9000);
+            space(2250);
+            mark(562);
+            space(10000);
+        end
+    endtask
+
+    // RC5 frame of 14 bits sent MSB first.  A one is a space then a mark.
+    task rc5;
+        input [13:0] data;
+        begin
+            for (i = 0; i < 14; i = i + 1)
+            begin
+                half(~data[13 - i], 889);
+                half(data[13 - i], 889);
+            end
+            space(10000);
+        end
+    endtask
+
+    // RC5 frame with bit 6 sent as a mark for the whole bit
+    task rc5bad;
+        input [13:0] data;
+        begin
+            for (i = 0; i < 14; i = i + 1)
+            begin
+                half((i == 7) | ~data[13 - i], 889);
+                half((i == 7) | data[13 - i], 889);
+            end
+            space(10000);
+        end
+    endtask
+
+    // RC6 frame of 21 bits sent MSB first.  A one is a mark then a space.
+    // Bit 16 is the double width trailer bit.
+    task rc6;
+        input [20:0] data;
+        begin
+            mark(2666);
+            space(889);
+            for (i = 0; i < 21; i = i + 1)
+            begin
+                half(data[20 - i], (i == 4) ? 889 : 444);
+                half(~data[20 - i], (i == 4) ? 889 : 444);
+            end
+            space(10000);
+        end
+    endtask
+
+    // SIRC frame sent LSB first.  A one is a 1200 us mark.
+    task sirc;
+        input [19:0] data;
+        input [4:0] nbits;
+        begin
+            mark(2400);
+            space(600);
+            for (i = 0; i < nbits; i = i + 1)
+            begin
+                mark((data[i]) ? 1200 : 600);
+                space(600);
+            end
+            space(10000);
+        end
+    endtask
+
+    // Read a register
+    task rdreg;
+        input [7:0] addr;
+        begin
+            @(negedge CLK_I)
+            WE_I = 0; TGA_I = 1; STB_I = 1; ADR_I = addr; DAT_I = 0;
+            @(posedge CLK_I)
+            got = {got[23:0], DAT_O};
+            @(negedge CLK_I)
+            WE_I = 0; TGA_I = 0; STB_I = 0; ADR_I = 0; DAT_I = 0;
+        end
+    endtask
+
+    // Verify that the FIFO has exactly one record and that it matches
+    task checkrec;
+        input [31:0] rec;
+        begin
+            rdreg(69);
+            status = got[7:0];
+            if (status[4:0] != 1)
+            begin
+                $display("FAIL: %0d records in FIFO, expected 1", status[4:0]);
+                errors = errors + 1;
+            end
+            rdreg(0);
+            rdreg(1);
+            rdreg(2);
+            rdreg(3);
+            if (got != rec)
+            begin
+                $display("FAIL: record %h, expected %h", got, rec);
+                errors = errors + 1;
+            end
+            else
+                $display("PASS: record %h", got);
+            // Remove any extra records
+            while (status[4:0] > 1)
+            begin
+                rdreg(3);
+                status = status - 1;
+            end
+        end
+    endtask
+
+    // Verify that the FIFO is empty
+    task checknone;
+        begin
+            rdreg(69);
+            if (got[4:0] != 0)
+            begin
+                $display("FAIL: %0d records in FIFO, expected 0", got[4:0]);
+                errors = errors + 1;
+                rdreg(0);
+                rdreg(1);
+                rdreg(2);
+                rdreg(3);
+                $display("      record %h", got);
+            end
+            else
+                $display("PASS: no record");
+        end
+    endtask
+
+
+    // Test the device
+    initial
+    begin
+        $display($time);
+        $dumpfile ("irio_tb.xt2");
+        $dumpvars (0, irio_tb);
+        //  - Set bus lines and FPGA pins to default state
+        WE_I = 0; TGA_I = 0; STB_I = 0; ADR_I = 0; DAT_I = 0;
+        irin = 1;
+        errors = 0;
+        got = 0;
+
+        #20000000    // let the receiver see an idle line
+
+        //  - NEC address 0x815a, command 0x3c, then a repeat code
+        nec({~8'h3c, 8'h3c, 8'h81, 8'h5a});
+        checkrec(32'h10815a3c);
+        space(30000);
+        necrpt;
+        checkrec(32'h11815a3c);
+
+        //  - A repeat code long after the last one is ignored
+        space(120000);
+        necrpt;
+        checknone;
+
+        //  - RC5: start, field=1, toggle=1, address 0x05, command 0x35
+        rc5({1'b1, 1'b1, 1'b1, 5'h05, 6'h35});
+        checkrec(32'h21000535);
+
+        //  - An RC5 bit with no transition in the middle is an error
+        rc5bad({1'b1, 1'b1, 1'b1, 5'h05, 6'h35});
+        checknone;
+
+        //  - RC6 mode 0: start, mode 000, toggle=1, address 0xa5, command 0xc3
+        rc6({1'b1, 3'b000, 1'b1, 8'ha5, 8'hc3});
+        checkrec(32'h3100a5c3);
+
+        //  - SIRC with 12, 15, and 20 bits
+        sirc({8'h0, 5'h01, 7'h15}, 12);
+        checkrec(32'h40000115);
+        sirc({5'h0, 8'ha5, 7'h2a}, 15);
+        checkrec(32'h4200a52a);
+        sirc({13'h1abc, 7'h7f}, 20);
+        checkrec(32'h441abc7f);
+
+        if (errors == 0)
+            $display("irio_tb: all tests passed");
+        else
+            $display("irio_tb: %0d errors", errors);
+
+        $finish;
+    end
+endmodule
+